@@ -1,4 +1,7 @@
 #version 440 core
+#ifdef GL_ARB_shader_clock
+#extension GL_ARB_shader_clock : enable
+#endif
 
 layout(location = 0) out vec4 color;
 
@@ -9,6 +12,43 @@ uniform dvec2 screenOffset;
 uniform sampler1D tex;
 uniform float freq;
 uniform float UVoffset;
+uniform bool countIterations;
+uniform int heatmap;    // 0 = palette, 1 = tile iterations, 2 = tile time (shader clock)
+
+// Iterations of the frame for the performance panel, as a 64-bit sum in two words
+layout(std430, binding = 0) buffer IterationCounter
+{
+    uint iterationsLow;
+    uint iterationsHigh;
+};
+
+// Escape iteration histogram, binned like IterationStats on the CPU
+layout(std430, binding = 1) buffer IterationHistogram
+{
+    uint bounded;
+    uint maxEscape;
+    uint bins[64];
+};
+
+// Cost of every 16x16 tile (row-major from the top left) and the highest of them,
+// summed this frame into TileCostWrite and shown from last frame's TileCostRead
+const int HeatTile = 16;
+layout(std430, binding = 2) buffer TileCostWrite
+{
+    uint maxTileCost;
+    uint tileCost[];
+};
+layout(std430, binding = 3) readonly buffer TileCostRead
+{
+    uint lastMaxTileCost;
+    uint lastTileCost[];
+};
+
+// Same ramp as HeatColor() on the CPU: black, red, yellow, white
+vec4 HeatColor(float t)
+{
+    return vec4(clamp(t * 3.0, 0.0, 1.0), clamp(t * 3.0 - 1.0, 0.0, 1.0), clamp(t * 3.0 - 2.0, 0.0, 1.0), 1.0);
+}
 
 const double C = 4.0;
 
@@ -54,7 +94,36 @@ void main()
 {
     vec4 cl1, cl2;
     dvec2 coord = dvec2(gl_FragCoord.xy);
+#ifdef GL_ARB_shader_clock
+    uint clockStart = clock2x32ARB().x;
+#endif
     double t = IterationsNumber((coord - screenSize/2)/zoom - screenOffset);
+    if(countIterations)
+    {
+        uint n = uint(t);
+        if(atomicAdd(iterationsLow, n) > 0xFFFFFFFFu - n)
+            atomicAdd(iterationsHigh, 1u);
+        if(n >= uint(iter))
+            atomicAdd(bounded, 1u);
+        else
+        {
+            atomicAdd(bins[n * 64u / uint(iter)], 1u);
+            atomicMax(maxEscape, n);
+        }
+    }
+    if(heatmap != 0)
+    {
+        uint cost = uint(t);
+#ifdef GL_ARB_shader_clock
+        if(heatmap == 2)
+            cost = clock2x32ARB().x - clockStart;
+#endif
+        ivec2 tile = ivec2(gl_FragCoord.x, screenSize.y - gl_FragCoord.y) / HeatTile;
+        uint index = uint(tile.y * ((int(screenSize.x) + HeatTile - 1) / HeatTile) + tile.x);
+        atomicMax(maxTileCost, atomicAdd(tileCost[index], cost) + cost);
+        color = HeatColor(lastMaxTileCost > 0u ? float(lastTileCost[index]) / float(lastMaxTileCost) : 0.0);
+        return;
+    }
     //double t = NormalizedIteration((coord - screenSize * 0.5)/zoom - screenOffset);
     if(t==iter) color = vec4(0.0f, 0.0f, 0.0f, 1.0f);
     else
@@ -8,6 +8,10 @@
 #include <chrono>
 #include "shader.h"
 #include "texture.h"
+#include "profiler.h"
+#include "perfpanel.h"
+#include <algorithm>
+#include <fstream>
 
 int App::s_fixedDeltaTime = 10; // milliseconds
 
@@ -30,9 +34,13 @@ void App::run()
 
     onCreate();
 
-    std::thread fixedUpdateThread(&App::timing_thread, this);
+    // A replay delivers the recorded fixed update ticks itself
+    std::thread fixedUpdateThread;
+    if(!m_replay)
+        fixedUpdateThread = std::thread(&App::timing_thread, this);
     render();
-    fixedUpdateThread.join();
+    if(fixedUpdateThread.joinable())
+        fixedUpdateThread.join();
 
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
@@ -68,13 +76,32 @@ void App::resetDefaultValues()
     m_params.UVChange = false;
 }
 
+void App::recordInput(const std::string& path)
+{
+    m_recorder.reset(new InputRecorder(path, m_width, m_height));
+}
+
+void App::replayInput(const std::string& path, bool maxSpeed, const std::string& report)
+{
+    m_replay.reset(new InputReplay(path));
+    m_replayMaxSpeed = maxSpeed;
+    m_replayReport = report;
+    // Same framing as the recording
+    m_width = m_replay->width();
+    m_height = m_replay->height();
+}
+
 void App::initWindow()
 {
     if(!glfwInit())
         throw std::runtime_error("[GLFW]: Could not initialize GLFW!");
+    m_startup.phase("glfwInit");
 
     m_window = glfwCreateWindow(m_width, m_height, "Mandelbrot", nullptr, nullptr);
     glfwMakeContextCurrent(m_window);
+    if(m_replay && m_replayMaxSpeed)
+        glfwSwapInterval(0);
+    m_startup.phase("create window");
 
     glfwSetErrorCallback([](int e, const char *s){std::cerr << "[GLFW ERROR]: " << s << "\n";});
     glfwSetKeyCallback(m_window, App::key_callback);
@@ -85,6 +112,7 @@ void App::initWindow()
 
     if(glewInit() != GLEW_OK)
         throw std::runtime_error("[GLEW]: Could not initialize GLEW!");
+    m_startup.phase("glewInit");
 
 #ifdef MANDELBROT_DEBUG
     std::cout << glGetString(GL_VERSION) << std::endl;
@@ -101,6 +129,8 @@ void App::initWindow()
     io.ConfigFlags |= ImGuiConfigFlags_NavEnableGamepad;      // Enable Gamepad Controls
     io.ConfigFlags |= ImGuiConfigFlags_DockingEnable;         // Enable Docking
     io.ConfigFlags |= ImGuiConfigFlags_ViewportsEnable;       // Enable Multi-Viewport / Platform Windows
+    if(m_replay)                                              // Live input would diverge from the recording
+        io.ConfigFlags |= ImGuiConfigFlags_NoMouse | ImGuiConfigFlags_NoKeyboard;
     ImGui::StyleColorsDark();
 
     // When viewports are enabled we tweak WindowRounding/WindowBg so platform windows can look identical to regular ones.
@@ -113,6 +143,7 @@ void App::initWindow()
 
     ImGui_ImplGlfw_InitForOpenGL(m_window, true);
     ImGui_ImplOpenGL3_Init();
+    m_startup.phase("ImGui init");
 }
 
 
@@ -140,10 +171,28 @@ void App::onCreate()
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2*sizeof(float), nullptr);
 
+    // Decode the 1D textures on another thread while the driver compiles the shaders
+    /// Special thanks to Alexandra Toma for some textures ideas
+    /// and to Daniel Ghindea for creating the textures
+    std::vector<PaletteImage> palettes;
+    double decodeMs = 0;
+    std::thread decoder([&palettes, &decodeMs]()
+    {
+        PROFILE_THREAD_NAME("palette decode");
+        PROFILE_SCOPE("decode palettes");
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        const char* paths[] = { "img/pal.png", "img/pal2.png", "img/pal4.png", "img/pal5.png", "img/pal6.png" };
+        for(const char* path : paths)
+            palettes.push_back(DecodePNG_1D(path));
+        decodeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    });
+    m_startup.phase("vertex buffer");
+
     // compile shaders
     unsigned int VertexShaderID, FragmentShaderID;
     VertexShaderID   = Shader::CreateShader(Shader::vertex, "shaders/vertex.glsl");
     FragmentShaderID = Shader::CreateShader(Shader::fragment, "shaders/fragment.glsl");
+    m_startup.phase("compile shaders");
 
     // link shaders
     unsigned int program = glCreateProgram();
@@ -152,11 +201,16 @@ void App::onCreate()
     glLinkProgram(program);
     glValidateProgram(program);
     glUseProgram(program);
+    m_startup.phase("link program");
 
-    // Load 1D textures
-    /// Special thanks to Alexandra Toma for some textures ideas
-    /// and to Daniel Ghindea for creating the textures
-    LoadTexVectorVar(m_textures, 5, "img/pal.png", "img/pal2.png", "img/pal4.png", "img/pal5.png", "img/pal6.png");
+    // Upload the textures once decoded
+    decoder.join();
+    m_startup.phase("wait for palettes");
+    m_startup.background("decode palettes", decodeMs);
+    m_textures.clear();
+    for(const PaletteImage& palette : palettes)
+        m_textures.push_back(UploadTexture_1D(palette));
+    m_startup.phase("upload palettes");
 
     // Retrieve uniform locations
     m_uniform_loc.iter = glGetUniformLocation(program, "iter");
@@ -166,6 +220,8 @@ void App::onCreate()
     m_uniform_loc.tex = glGetUniformLocation(program, "tex");
     m_uniform_loc.freq = glGetUniformLocation(program, "freq");
     m_uniform_loc.UVoffset = glGetUniformLocation(program, "UVoffset");
+    m_uniform_loc.countIterations = glGetUniformLocation(program, "countIterations");
+    m_uniform_loc.heatmap = glGetUniformLocation(program, "heatmap");
 
     // Set initial uniform values
     glUniform1i(m_uniform_loc.iter, m_params.iter);
@@ -175,15 +231,23 @@ void App::onCreate()
     glUniform2d(m_uniform_loc.screenOffset, m_params.OffX, m_params.OffY);
     glUniform2d(m_uniform_loc.screenSize, (double)m_width, (double)m_height);
     glUniform1i(m_uniform_loc.tex, 0);
+    glUniform1i(m_uniform_loc.countIterations, 0);
+    glUniform1i(m_uniform_loc.heatmap, 0);
+
+    m_perfPanel.init();
+    m_heatmap.init();
 
     // Set active texture
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_1D, m_textures[0]);
+    m_startup.phase("uniforms and panels");
 }
 
 // This function is called once per frame
 void App::onUpdate()
 {
+    PROFILE_SCOPE("onUpdate");
+
     // set all uniforms
     glUniform1i(m_uniform_loc.iter, m_params.iter);
     glUniform1d(m_uniform_loc.zoom, m_params.zoom);
@@ -191,11 +255,21 @@ void App::onUpdate()
     glUniform1f(m_uniform_loc.UVoffset, m_params.UVoffset);
     glUniform2d(m_uniform_loc.screenOffset, m_params.OffX, m_params.OffY);
     glUniform2d(m_uniform_loc.screenSize, (double)m_width, (double)m_height);
+    glUniform1i(m_uniform_loc.countIterations, m_showFPS && m_perfPanel.countIterations());
+    glUniform1i(m_uniform_loc.heatmap, m_heatmap.mode());
 
     // draw call
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    {
+        PROFILE_SCOPE("fractal pass");
+        m_perfPanel.beginFractalPass();
+        m_heatmap.beginFractalPass(m_width, m_height);
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+        m_heatmap.endFractalPass();
+        m_perfPanel.endFractalPass();
+    }
 
     // ImGui stuff
+    PROFILE_SCOPE("ImGui");
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplGlfw_NewFrame();
     ImGui::NewFrame();
@@ -227,6 +301,9 @@ void App::onUpdate()
         ImGui::Checkbox("Auto Zoom", &m_params.isZooming);
         ImGui::Checkbox("Frequency Animation", &m_params.freqChange);
         ImGui::Checkbox("UV Animation", &m_params.UVChange);
+        ImGui::Checkbox("Show Performance", &m_showFPS);
+        ImGui::Checkbox("Performance Counters", &m_showPerfCounters);
+        m_heatmap.drawControls();
         if(ImGui::Button("Reset Parameters"))
             resetDefaultValues();
 
@@ -234,6 +311,30 @@ void App::onUpdate()
         ImGui::End();
     }
 
+    if(m_showFPS)
+        m_perfPanel.draw(&m_showFPS);
+
+    // CPU side of the frame on the render thread (uniforms, draw submission, UI, swap)
+    if(m_showPerfCounters)
+    {
+        ImGui::Begin("Performance Counters", &m_showPerfCounters);
+        if(!m_perf->available())
+            ImGui::TextWrapped("Hardware counters unavailable: %s", m_perf->error().c_str());
+        else if(m_perfShownFrames > 0)
+        {
+            ImGui::Text("Render thread, per frame (%d frames)", m_perfShownFrames);
+            for(int e = 0; e < PerfEventCount; e++)
+            {
+                if(m_perfShown.has(e))
+                    ImGui::Text("%-14s %14.0f", PerfEventName(e), (double)m_perfShown.value[e] / m_perfShownFrames);
+                else
+                    ImGui::Text("%-14s %14s", PerfEventName(e), "n/a");
+            }
+            ImGui::Text("%-14s %14.2f", "IPC", m_perfShown.ipc());
+        }
+        ImGui::End();
+    }
+
     ImGui::Render();
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 }
@@ -266,10 +367,40 @@ void App::onFixedUpdate()
     }
 }
 
+void App::updatePerfCounters(const PerfCounts& frame)
+{
+    m_perfSum += frame;
+    m_perfFrames++;
+    double now = glfwGetTime();
+    if(now - m_perfLastUpdate >= 0.5)
+    {
+        m_perfShown = m_perfSum;
+        m_perfShownFrames = m_perfFrames;
+        m_perfSum = PerfCounts();
+        m_perfFrames = 0;
+        m_perfLastUpdate = now;
+    }
+}
+
 void App::render()
 {
+    // Counters belong to the thread that opens them
+    m_perf.reset(new PerfCounters());
+    PROFILE_THREAD_NAME("render");
+
+    // Recording and replay both measure time from the first frame
+    m_replayStart = glfwGetTime();
+    if(m_recorder)
+        m_recorder->start();
     while(!glfwWindowShouldClose(m_window))
     {
+        PROFILE_SCOPE("frame");
+        const double frameStart = glfwGetTime();
+        const bool countFrame = m_showPerfCounters && m_perf->available();
+        if(countFrame)
+            m_perf->start();
+        m_perfPanel.beginFrame();
+
         glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
 
@@ -280,106 +411,232 @@ void App::render()
         //  For this specific demo app we could also call glfwMakeContextCurrent(window) directly)
         if (ImGui::GetIO().ConfigFlags & ImGuiConfigFlags_ViewportsEnable)
         {
+            PROFILE_SCOPE("platform windows");
             GLFWwindow* backup_current_context = glfwGetCurrentContext();
             ImGui::UpdatePlatformWindows();
             ImGui::RenderPlatformWindowsDefault();
             glfwMakeContextCurrent(backup_current_context);
         }
 
-        glfwSwapBuffers(m_window);
-        glfwPollEvents();
+        {
+            PROFILE_SCOPE("swap buffers");
+            glfwSwapBuffers(m_window);
+        }
+        if(!m_startupReported)
+        {
+            m_startup.phase("first frame");
+            m_startup.report(std::cout);
+            m_startupReported = true;
+        }
+        {
+            PROFILE_SCOPE("poll events");
+            glfwPollEvents();
+        }
+
+        if(m_replay)
+            replayFrame((float)((glfwGetTime() - frameStart) * 1000.0));
+        m_frameIndex++;
+
+        m_perfPanel.endFrame(m_width, m_height, m_params.iter, m_params.zoom);
+        if(countFrame)
+            updatePerfCounters(m_perf->stop());
     }
 }
 
 void App::timing_thread()
 {
     // No OpenGL calls should be made here.
+    PROFILE_THREAD_NAME("fixed update");
     typedef std::chrono::time_point<std::chrono::steady_clock> TP;
     while(!glfwWindowShouldClose(m_window))
     {
         TP moment = std::chrono::steady_clock::now() + std::chrono::milliseconds(s_fixedDeltaTime);
-        onFixedUpdate();
+        {
+            PROFILE_SCOPE("onFixedUpdate");
+            InputEvent tick;
+            tick.type = InputEvent::FixedUpdate;
+            input(tick);
+        }
         std::this_thread::sleep_until(moment);
     }
 }
 
 
 
-void App::key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
+void App::replayFrame(float frameMs)
 {
-    if(action != GLFW_PRESS)
+    // Events that arrived during this frame are handled at its end, like live callbacks
+    InputEvent event;
+    while(m_replay->next(m_frameIndex, glfwGetTime() - m_replayStart, m_replayMaxSpeed, event))
+        handleInput(event);
+    m_replayFrameMs.push_back(frameMs);
+    if(!m_replay->finished())
         return;
 
-    App& app = App::getInstance();
-
-    if(key == GLFW_KEY_KP_ADD)
-        app.m_params.zoom *= 2;
-    else if(key == GLFW_KEY_KP_SUBTRACT)
-        app.m_params.zoom /= 2;
-    else if(key == GLFW_KEY_E)
-        app.m_params.iter += 50;
-    else if(key == GLFW_KEY_Q)
-        app.m_params.iter -= 50;
-    else if(key == GLFW_KEY_Z)
-        app.m_params.isZooming = !app.m_params.isZooming;
-    else if(key == GLFW_KEY_R)
-        app.resetDefaultValues();
-    else if(key == GLFW_KEY_F)
-        app.m_params.freqChange = !app.m_params.freqChange;
-    else if(key == GLFW_KEY_G)
-        app.m_params.UVChange = !app.m_params.UVChange;
-    else if(key == GLFW_KEY_N)
+    SlidingWindow frames(m_replayFrameMs.size());
+    for(float ms : m_replayFrameMs)
+        frames.push(ms);
+    std::printf("[Replay]: %zu events, %zu frames in %.2fs (%s)\n", m_replay->size(), m_replayFrameMs.size(),
+                glfwGetTime() - m_replayStart, m_replayMaxSpeed ? "max speed" : "recorded speed");
+    std::printf("[Replay]: frame ms  mean %.2f  p50 %.2f  p90 %.2f  p99 %.2f  max %.2f\n", frames.mean(),
+                frames.percentile(0.5f), frames.percentile(0.9f), frames.percentile(0.99f), frames.percentile(1.0f));
+    if(!m_replayReport.empty())
     {
-        app.m_active_texture++;
-        if(app.m_active_texture == app.m_textures.size())
-            app.m_active_texture=0;
+        std::ofstream out(m_replayReport, std::ios::trunc);
+        out << "frame,frame_ms\n";
+        for(size_t f = 0; f < m_replayFrameMs.size(); f++)
+            out << f << "," << m_replayFrameMs[f] << "\n";
+        std::printf("[Replay]: frame times written to %s\n", m_replayReport.c_str());
     }
+    glfwSetWindowShouldClose(m_window, 1);
+}
 
-    //else if(key == GLFW_KEY_A)
-    //    showFPS = !showFPS;
+void App::input(InputEvent event)
+{
+    if(m_replay)
+        return;
+    event.frame = m_frameIndex;
+    if(m_recorder)
+        m_recorder->record(event);
+    handleInput(event);
+}
 
-    /*else if(key == GLFW_KEY_L)
+void App::handleInput(const InputEvent& event)
+{
+    switch(event.type)
     {
-        LoadCustomSettings(app.m_params.iter,
-                           app.m_params.zoom,
-                           app.m_params.OffX,
-                           app.m_params.OffY,
-                           app.m_params.freq,
-                           app.m_params.UVoffset);
-    }*/
+    case InputEvent::Key:
+        if(event.action != GLFW_PRESS)
+            return;
+        if(event.code == GLFW_KEY_KP_ADD)
+            m_params.zoom *= 2;
+        else if(event.code == GLFW_KEY_KP_SUBTRACT)
+            m_params.zoom /= 2;
+        else if(event.code == GLFW_KEY_E)
+            m_params.iter += 50;
+        else if(event.code == GLFW_KEY_Q)
+            m_params.iter -= 50;
+        else if(event.code == GLFW_KEY_Z)
+            m_params.isZooming = !m_params.isZooming;
+        else if(event.code == GLFW_KEY_R)
+            resetDefaultValues();
+        else if(event.code == GLFW_KEY_F)
+            m_params.freqChange = !m_params.freqChange;
+        else if(event.code == GLFW_KEY_G)
+            m_params.UVChange = !m_params.UVChange;
+        else if(event.code == GLFW_KEY_P && Profiler::Enabled())
+        {
+            if(Profiler::WriteChromeTrace("trace.json"))
+                std::cout << "[Profiler]: trace written to trace.json" << std::endl;
+        }
+        else if(event.code == GLFW_KEY_N)
+        {
+            m_active_texture++;
+            if(m_active_texture == m_textures.size())
+                m_active_texture=0;
+        }
+        else if(event.code == GLFW_KEY_A)
+            m_showFPS = !m_showFPS;
+        else if(event.code == GLFW_KEY_H)
+            m_heatmap.cycleMode();
+        else if(event.code == GLFW_KEY_J)
+        {
+            // Runs inside a GLFW callback, which an exception must not unwind through
+            std::string path = std::string("heatmap.") + HeatmapModeName(m_heatmap.mode()) + ".png";
+            try
+            {
+                if(m_heatmap.dump(path))
+                    std::cout << "[Heatmap]: tile costs written to " << path << std::endl;
+            }
+            catch(const std::runtime_error& e)
+            {
+                std::cerr << "Error " << e.what() << std::endl;
+            }
+        }
+
+        /*else if(event.code == GLFW_KEY_L)
+        {
+            LoadCustomSettings(m_params.iter,
+                               m_params.zoom,
+                               m_params.OffX,
+                               m_params.OffY,
+                               m_params.freq,
+                               m_params.UVoffset);
+        }*/
+        break;
+
+    case InputEvent::MouseButton:
+        if(event.code == GLFW_MOUSE_BUTTON_LEFT && event.action == GLFW_PRESS)
+        {
+            m_params.isDragging = true;
+            oldx = event.x;
+            oldy = event.y;
+        }
+        else if(event.code == GLFW_MOUSE_BUTTON_LEFT && event.action == GLFW_RELEASE)
+            m_params.isDragging = false;
+        break;
+
+    case InputEvent::CursorPos:
+        if(!m_params.isDragging) return;
+        m_params.OffX += (event.x - oldx) / m_params.zoom;
+        m_params.OffY += (oldy - event.y) / m_params.zoom;
+        //m_params.OffX += (event.x - oldx);
+        //m_params.OffY += (oldy - event.y);
+        oldx = event.x;
+        oldy = event.y;
+        break;
+
+    case InputEvent::Scroll:
+        if(event.mods)
+            m_params.iter += int(event.y) * 5;
+        else
+            m_params.zoom += event.y * 10 * (m_params.zoom/100.0);
+        break;
+
+    case InputEvent::FixedUpdate:
+        onFixedUpdate();
+        break;
+    }
+}
+
+void App::key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+    InputEvent event;
+    event.type = InputEvent::Key;
+    event.code = key;
+    event.action = action;
+    event.mods = mods;
+    App::getInstance().input(event);
 }
 
 void App::mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
 {
-    App& app = App::getInstance();
-    if(button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS)
-    {
-        app.m_params.isDragging = true;
-        glfwGetCursorPos(window, &app.oldx, &app.oldy); //?
-    }
-    else if(button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_RELEASE)
-        app.m_params.isDragging = false;
+    InputEvent event;
+    event.type = InputEvent::MouseButton;
+    event.code = button;
+    event.action = action;
+    event.mods = mods;
+    glfwGetCursorPos(window, &event.x, &event.y);
+    App::getInstance().input(event);
 }
 
 void App::cursor_position_callback(GLFWwindow* window, double xpos, double ypos)
 {
-    App& app = App::getInstance();
-    if(!app.m_params.isDragging) return;
-    app.m_params.OffX += (xpos - app.oldx) / app.m_params.zoom;
-    app.m_params.OffY += (app.oldy - ypos) / app.m_params.zoom;
-    //app.m_params.OffX += (xpos - app.oldx);
-    //app.m_params.OffY += (app.oldy - ypos);
-    app.oldx = xpos;
-    app.oldy = ypos;
+    InputEvent event;
+    event.type = InputEvent::CursorPos;
+    event.x = xpos;
+    event.y = ypos;
+    App::getInstance().input(event);
 }
 
 void App::scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 {
-    App& app = App::getInstance();
-    if(glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-        app.m_params.iter += int(yoffset) * 5;
-    else
-        app.m_params.zoom += yoffset * 10 * (app.m_params.zoom/100.0);
+    InputEvent event;
+    event.type = InputEvent::Scroll;
+    event.mods = glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS;
+    event.x = xoffset;
+    event.y = yoffset;
+    App::getInstance().input(event);
 }
 
 void App::window_size_callback(GLFWwindow* window, int w, int h)
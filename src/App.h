@@ -5,6 +5,13 @@
 #include <GLFW/glfw3.h>
 #include <vector>
 #include <string>
+#include <memory>
+#include <atomic>
+#include "perfcounters.h"
+#include "perfpanel.h"
+#include "heatoverlay.h"
+#include "inputlog.h"
+#include "startuptimer.h"
 
 class App
 {
@@ -14,6 +21,13 @@ class App
     void initWindow();
     void run();
 
+    // Call before initWindow(). Recording saves the four GLFW input callbacks (key, mouse
+    // button, cursor position, scroll) and fixed update ticks to `path`; replaying feeds them back instead of the live input, either
+    // at the recorded speed or frame by frame as fast as possible, then prints
+    // frame time statistics (and writes them per frame to `report`, if given) and closes.
+    void recordInput(const std::string& path);
+    void replayInput(const std::string& path, bool maxSpeed, const std::string& report);
+
     //static callback functions
     static void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
     static void mouse_button_callback(GLFWwindow* window, int button, int action, int mods);
@@ -29,6 +43,11 @@ class App
     void render();
     void timing_thread();
     void resetDefaultValues();
+    void updatePerfCounters(const PerfCounts& frame);
+    // Records live input, ignored while replaying
+    void input(InputEvent event);
+    void handleInput(const InputEvent& event);
+    void replayFrame(float frameMs);
 
     static int s_fixedDeltaTime;
 
@@ -36,7 +55,7 @@ class App
     std::vector<uint32_t> m_textures;
 
     struct {
-        int iter, zoom, freq, tex, screenOffset, screenSize, UVoffset;
+        int iter, zoom, freq, tex, screenOffset, screenSize, UVoffset, countIterations, heatmap;
     }m_uniform_loc;
 
     int m_width = 800;
@@ -56,6 +75,29 @@ class App
         bool isDragging = false;
     } m_params;
 
+    PerfPanel m_perfPanel;
+    HeatmapOverlay m_heatmap;
+    bool m_showFPS = false;
+
+    // Hardware counters of the render thread, averaged over half a second of frames
+    std::unique_ptr<PerfCounters> m_perf;
+    bool m_showPerfCounters = false;
+    PerfCounts m_perfSum, m_perfShown;
+    int m_perfFrames = 0, m_perfShownFrames = 0;
+    double m_perfLastUpdate = 0;
+
+    // Started with the App, reported after the first frame
+    StartupTimer m_startup;
+    bool m_startupReported = false;
+
+    std::unique_ptr<InputRecorder> m_recorder;
+    std::unique_ptr<InputReplay> m_replay;
+    bool m_replayMaxSpeed = false;
+    std::string m_replayReport;
+    std::vector<float> m_replayFrameMs;
+    double m_replayStart = 0;
+    std::atomic<uint64_t> m_frameIndex{0};
+
     //temporary
     double oldx = 0, oldy = 0;
     const float UVoffsetCoef = 0.002f;
@@ -0,0 +1,188 @@
+#include "area.h"
+#include "fractal.h"
+#include "threadpool.h"
+#include "random.h"
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <mutex>
+#include <stdexcept>
+#include <cstdio>
+
+namespace
+{
+    const double MinX = -2.0, MaxX = 0.5, MaxY = 1.25;
+    // Both halves of the set, which is symmetric about the real axis
+    const double DomainArea = 2.0 * (MaxX - MinX) * MaxY;
+    const char* ResultMagic = "MandelbrotSet area 1";
+}
+
+double AreaResult::area() const
+{
+    double strata = (double)grid * grid;
+    return DomainArea * inside / (strata * perStratum);
+}
+
+double AreaResult::standardError() const
+{
+    // Var(p_i) is estimated by k(n-k) / (n^2 (n-1)) in each stratum
+    double strata = (double)grid * grid;
+    double n = (double)perStratum;
+    return DomainArea / strata * std::sqrt(spread / (n * n * (n - 1)));
+}
+
+AreaResult EstimateArea(const AreaJob& job)
+{
+    if(job.samples < 1 || job.iter <= 0 || job.shards <= 0 || job.shard < 0 || job.shard >= job.shards)
+        throw std::runtime_error("[Area]: Invalid job");
+
+    typedef std::chrono::steady_clock Clock;
+
+    AreaResult result;
+    result.iter = job.iter;
+    result.seed = job.seed;
+    result.shards = job.shards;
+    result.shardIndices.push_back(job.shard);
+    // About 64 samples per stratum, at least 2 so that every stratum has a variance estimate
+    result.grid = job.grid > 0 ? job.grid : std::max(1, std::min(8192, (int)std::sqrt(job.samples / 64)));
+    const double strata = (double)result.grid * result.grid;
+    result.perStratum = std::max<uint64_t>(2, (uint64_t)std::ceil(job.samples / strata));
+
+    const int grid = result.grid;
+    const uint64_t n = result.perStratum;
+    const double cellW = (MaxX - MinX) / grid, cellH = MaxY / grid;
+
+    std::vector<int> rows;
+    for(int r = job.shard; r < grid; r += job.shards)
+        rows.push_back(r);
+    std::vector<uint64_t> rowInside(rows.size()), rowSpread(rows.size()), rowIterations(rows.size());
+
+    ThreadPool pool(job.threads);
+    std::cout << "[Area]: " << grid << "x" << grid << " strata, " << n << " samples each, shard " << job.shard + 1
+              << "/" << job.shards << " (" << rows.size() << " rows) on " << pool.size() << " threads" << std::endl;
+
+    std::atomic<int> rowsDone(0);
+    std::mutex reportMutex;
+    Clock::time_point start = Clock::now(), lastReport = start;
+    pool.parallelFor((int)rows.size(), [&](int index, unsigned)
+    {
+        const int r = rows[index];
+        uint64_t inside = 0, spread = 0, iterations = 0;
+        for(int c = 0; c < grid; c++)
+        {
+            Random random(job.seed * 0xD1B54A32D192ED03ull + (uint64_t)r * grid + c);
+            uint64_t k = 0;
+            for(uint64_t s = 0; s < n; s++)
+            {
+                double cx = MinX + (c + random.uniform()) * cellW;
+                double cy = (r + random.uniform()) * cellH;
+                int spent;
+                if(Fractal::InSet(cx, cy, job.iter, spent))
+                    k++;
+                iterations += spent;
+            }
+            inside += k;
+            spread += k * (n - k);
+        }
+        rowInside[index] = inside;
+        rowSpread[index] = spread;
+        rowIterations[index] = iterations;
+
+        int done = ++rowsDone;
+        Clock::time_point now = Clock::now();
+        std::lock_guard<std::mutex> lock(reportMutex);
+        if(now - lastReport > std::chrono::seconds(1))
+        {
+            double elapsed = std::chrono::duration<double>(now - start).count();
+            double progress = (double)done / rows.size();
+            std::printf("\r[Area]: %5.1f%%  ETA %.0fs   ", progress * 100, elapsed / progress - elapsed);
+            std::fflush(stdout);
+            lastReport = now;
+        }
+    });
+
+    for(size_t i = 0; i < rows.size(); i++)
+    {
+        result.inside += rowInside[i];
+        result.spread += rowSpread[i];
+        result.iterations += rowIterations[i];
+    }
+
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    double samples = (double)rows.size() * grid * n;
+    std::printf("\r[Area]: %.3g samples in %.2fs  %.2f Msamples/s  %.3f Giter/s\n", samples, elapsed,
+                samples / elapsed * 1e-6, result.iterations / elapsed * 1e-9);
+    return result;
+}
+
+void SaveAreaResult(const std::string& path, const AreaResult& result)
+{
+    std::ofstream out(path, std::ios::trunc);
+    out << ResultMagic << "\n" << result.grid << " " << result.perStratum << " " << result.iter << " "
+        << result.seed << " " << result.shards << "\n" << result.shardIndices.size();
+    for(int s : result.shardIndices)
+        out << " " << s;
+    out << "\n" << result.inside << " " << result.spread << " " << result.iterations << "\n";
+    if(!out)
+        throw std::runtime_error("[Area]: Could not write " + path);
+}
+
+static AreaResult LoadAreaResult(const std::string& path)
+{
+    std::ifstream in(path);
+    std::string magic;
+    std::getline(in, magic);
+    AreaResult result;
+    size_t count = 0;
+    in >> result.grid >> result.perStratum >> result.iter >> result.seed >> result.shards >> count;
+    result.shardIndices.resize(count);
+    for(int& s : result.shardIndices)
+        in >> s;
+    in >> result.inside >> result.spread >> result.iterations;
+    if(!in || magic != ResultMagic)
+        throw std::runtime_error("[Area]: " + path + " is not an area result");
+    return result;
+}
+
+AreaResult CombineAreaResults(const std::vector<std::string>& paths)
+{
+    if(paths.empty())
+        throw std::runtime_error("[Area]: No results to combine");
+
+    AreaResult total = LoadAreaResult(paths[0]);
+    for(size_t i = 1; i < paths.size(); i++)
+    {
+        AreaResult part = LoadAreaResult(paths[i]);
+        if(part.grid != total.grid || part.perStratum != total.perStratum || part.iter != total.iter
+           || part.seed != total.seed || part.shards != total.shards)
+            throw std::runtime_error("[Area]: " + paths[i] + " belongs to a different job");
+        for(int s : part.shardIndices)
+        {
+            if(std::find(total.shardIndices.begin(), total.shardIndices.end(), s) != total.shardIndices.end())
+                throw std::runtime_error("[Area]: Shard " + std::to_string(s + 1) + " is included twice");
+            total.shardIndices.push_back(s);
+        }
+        total.inside += part.inside;
+        total.spread += part.spread;
+        total.iterations += part.iterations;
+    }
+    std::sort(total.shardIndices.begin(), total.shardIndices.end());
+    return total;
+}
+
+void PrintAreaResult(const AreaResult& result)
+{
+    if(!result.complete())
+    {
+        std::printf("[Area]: partial result, %zu of %d shards\n", result.shardIndices.size(), result.shards);
+        return;
+    }
+    double area = result.area(), error = result.standardError();
+    std::printf("[Area]: %.10f +- %.10f (1 sigma), 95%% interval [%.10f, %.10f]\n", area, error,
+                area - 1.96 * error, area + 1.96 * error);
+    std::printf("[Area]: points still bounded after %d iterations count as inside, biasing the estimate upwards\n",
+                result.iter);
+}
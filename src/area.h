@@ -0,0 +1,48 @@
+#ifndef MANDELBROTSET_AREA_H
+#define MANDELBROTSET_AREA_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Monte Carlo estimate of the area of the Mandelbrot set. The upper half plane
+// part of [-2, 0.5] x [0, 1.25] is split into a grid of strata with the same
+// number of jittered samples each. Rows of strata can be split between
+// processes (shards) whose partial results are combined afterwards.
+struct AreaJob
+{
+    double samples = 1e9;   // total over all shards
+    int iter = 10000;
+    int grid = 0;           // strata per side, 0 = chosen from the sample count
+    uint64_t seed = 1;
+    int shard = 0, shards = 1;
+    unsigned threads = 0;
+};
+
+// Integer tallies, so shards merge exactly and the result does not depend on
+// the number of threads or processes
+struct AreaResult
+{
+    int grid = 0;
+    uint64_t perStratum = 0;
+    int iter = 0;
+    uint64_t seed = 0;
+    int shards = 1;
+    std::vector<int> shardIndices;  // shards included in this result
+    uint64_t inside = 0;            // sum of k over strata
+    uint64_t spread = 0;            // sum of k(n-k) over strata, for the variance
+    uint64_t iterations = 0;
+
+    bool complete() const { return (int)shardIndices.size() == shards; }
+    double area() const;
+    double standardError() const;
+};
+
+AreaResult EstimateArea(const AreaJob& job);
+
+void SaveAreaResult(const std::string& path, const AreaResult& result);
+// Merges shard files of the same job, each shard at most once
+AreaResult CombineAreaResults(const std::vector<std::string>& paths);
+void PrintAreaResult(const AreaResult& result);
+
+#endif //MANDELBROTSET_AREA_H
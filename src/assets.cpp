@@ -0,0 +1,87 @@
+#include "assets.h"
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#ifndef MANDELBROT_EMBED_ASSETS
+// Without the generated tables everything comes from the disk
+const EmbeddedShader EmbeddedShaders[] = { { nullptr, nullptr } };
+const int EmbeddedShaderCount = 0;
+const EmbeddedPalette EmbeddedPalettes[] = { { nullptr, 0, nullptr } };
+const int EmbeddedPaletteCount = 0;
+#endif
+
+const std::string& Assets::OverrideDir()
+{
+    static const std::string dir = []()
+    {
+        const char* env = std::getenv("MANDELBROT_ASSET_DIR");
+        return std::string(env ? env : "");
+    }();
+    return dir;
+}
+
+namespace
+{
+    bool StartsWith(const char* s, const char* prefix)
+    {
+        return std::strncmp(s, prefix, std::strlen(prefix)) == 0;
+    }
+
+    // Relative paths of the assets shipped with the program; user files such as
+    // palettes passed to batch commands are not redirected
+    bool IsBundled(const char* path)
+    {
+        if(StartsWith(path, "shaders/") || StartsWith(path, "img/"))
+            return true;
+        for(int i = 0; i < EmbeddedShaderCount; i++)
+            if(std::strcmp(EmbeddedShaders[i].path, path) == 0)
+                return true;
+        for(int i = 0; i < EmbeddedPaletteCount; i++)
+            if(std::strcmp(EmbeddedPalettes[i].path, path) == 0)
+                return true;
+        return false;
+    }
+}
+
+std::string Assets::DiskPath(const char* path)
+{
+    const std::string& dir = OverrideDir();
+    if(dir.empty() || !IsBundled(path))
+        return path;
+    return dir + "/" + path;
+}
+
+bool Assets::LoadShaderSource(const char* path, std::string& source)
+{
+    if(OverrideDir().empty())
+    {
+        for(int i = 0; i < EmbeddedShaderCount; i++)
+        {
+            if(std::strcmp(EmbeddedShaders[i].path, path) == 0)
+            {
+                source = EmbeddedShaders[i].source;
+                return true;
+            }
+        }
+    }
+
+    std::ifstream in(DiskPath(path));
+    if(!in.is_open())
+        return false;
+    std::stringstream ss;
+    ss << in.rdbuf();
+    source = ss.str();
+    return true;
+}
+
+const EmbeddedPalette* Assets::FindPalette(const char* path)
+{
+    if(!OverrideDir().empty())
+        return nullptr;
+    for(int i = 0; i < EmbeddedPaletteCount; i++)
+        if(std::strcmp(EmbeddedPalettes[i].path, path) == 0)
+            return &EmbeddedPalettes[i];
+    return nullptr;
+}
@@ -0,0 +1,48 @@
+#ifndef MANDELBROTSET_ASSETS_H
+#define MANDELBROTSET_ASSETS_H
+
+#include <cstdint>
+#include <string>
+
+// Shader sources and palettes compiled into the executable by tools/embedassets.cpp
+// (CMake option MANDELBROT_EMBED_ASSETS). Assets are looked up by their path relative
+// to the source tree, e.g. "shaders/fragment.glsl", which is also the path they are
+// read from when they are not embedded.
+struct EmbeddedShader
+{
+    const char* path;
+    const char* source;
+};
+
+// Only the row of the image used as the 1D texture (the bottom one), as RGBA
+struct EmbeddedPalette
+{
+    const char* path;
+    int width;
+    const uint8_t* rgba;
+};
+
+extern const EmbeddedShader EmbeddedShaders[];
+extern const int EmbeddedShaderCount;
+extern const EmbeddedPalette EmbeddedPalettes[];
+extern const int EmbeddedPaletteCount;
+
+namespace Assets
+{
+    // Setting the MANDELBROT_ASSET_DIR environment variable loads every bundled asset from that
+    // directory instead of the embedded copies, e.g. to edit shaders without rebuilding.
+    // Empty when unset.
+    const std::string& OverrideDir();
+
+    // Where an asset is read from when it comes from the disk: bundled assets (relative
+    // paths under shaders/ and img/) move to the override directory, other paths stay as given
+    std::string DiskPath(const char* path);
+
+    // Embedded source unless overridden or not embedded, otherwise read from the disk
+    bool LoadShaderSource(const char* path, std::string& source);
+
+    // nullptr when overridden or not embedded
+    const EmbeddedPalette* FindPalette(const char* path);
+}
+
+#endif //MANDELBROTSET_ASSETS_H
@@ -0,0 +1,482 @@
+#include "batch.h"
+#include "options.h"
+#include "settings.h"
+#include "poster.h"
+#include "pyramid.h"
+#include "zoomvideo.h"
+#include "paletteanim.h"
+#include "cluster.h"
+#include "thumbnails.h"
+#include "area.h"
+#include "buddha.h"
+#include "bench.h"
+#include "tune.h"
+#include "golden.h"
+#include "verify.h"
+#include "profiler.h"
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <stdexcept>
+
+// Common view options: --settings FILE, then individual overrides
+static FractalParams ParseParams(const Options& opt)
+{
+    FractalParams params;
+    if(opt.has("settings") && !LoadCustomSettings(opt.get("settings").c_str(), params))
+        throw std::runtime_error("[Batch]: Could not read settings file " + opt.get("settings"));
+    params.iter = opt.getInt("iter", params.iter);
+    params.zoom = opt.getDouble("zoom", params.zoom);
+    params.OffX = opt.getDouble("offx", params.OffX);
+    params.OffY = opt.getDouble("offy", params.OffY);
+    params.freq = (float)opt.getDouble("freq", params.freq);
+    params.UVoffset = (float)opt.getDouble("uvoffset", params.UVoffset);
+    return params;
+}
+
+// "a,b,c" -> { "a", "b", "c" }
+static std::vector<std::string> SplitList(const std::string& list)
+{
+    std::vector<std::string> items;
+    size_t begin = 0;
+    while(begin <= list.size())
+    {
+        size_t end = list.find(',', begin);
+        if(end == std::string::npos)
+            end = list.size();
+        if(end > begin)
+            items.push_back(list.substr(begin, end - begin));
+        begin = end + 1;
+    }
+    return items;
+}
+
+static int RunPoster(const Options& opt)
+{
+    PosterJob job;
+    job.params = ParseParams(opt);
+    opt.getSize("size", job.width, job.height);
+    job.viewWidth = opt.getInt("view-width", job.viewWidth);
+    // Tuned settings for this machine, unless overridden below
+    if(!opt.has("no-tune"))
+    {
+        TuneResult tuned = LoadOrTune(opt.get("tuning", "tuning.txt"));
+        job.kernel = tuned.kernel;
+        job.tileWidth = tuned.tileWidth;
+        job.tileHeight = tuned.tileHeight;
+        job.threads = tuned.threads;
+    }
+    job.stripHeight = opt.getInt("strip", job.stripHeight);
+    job.tileWidth = opt.getInt("tile", job.tileWidth);
+    job.tileHeight = opt.getInt("tile-height", job.tileHeight);
+    job.threads = (unsigned)opt.getInt("threads", (int)job.threads);
+    job.kernel = opt.get("kernel", job.kernel);
+    job.palette = opt.get("palette", job.palette);
+    job.output = opt.get("out", job.output);
+    job.checkpoint = opt.get("checkpoint", job.checkpoint);
+    job.checkpointInterval = opt.getInt("checkpoint-interval", job.checkpointInterval);
+    job.restart = opt.has("restart");
+    job.heatmap = opt.has("heatmap");
+    RenderPoster(job);
+    return 0;
+}
+
+static int RunPyramid(const Options& opt)
+{
+    PyramidJob job;
+    job.params = ParseParams(opt);
+    std::string layout = opt.get("layout", "dzi");
+    if(layout == "xyz")
+    {
+        job.layout = PyramidJob::XYZ;
+        job.tileSize = 256;
+        job.overlap = 0;
+    }
+    else if(layout != "dzi")
+        throw std::runtime_error("[Batch]: Unknown pyramid layout " + layout);
+    opt.getSize("size", job.width, job.height);
+    job.viewWidth = opt.getInt("view-width", job.viewWidth);
+    job.tileSize = opt.getInt("tile", job.tileSize);
+    job.overlap = opt.getInt("overlap", job.overlap);
+    job.threads = (unsigned)opt.getInt("threads", 0);
+    job.palette = opt.get("palette", job.palette);
+    job.output = opt.get("out", job.output);
+    ExportPyramid(job);
+    return 0;
+}
+
+static int RunZoomVideo(const Options& opt)
+{
+    ZoomVideoJob job;
+    job.params = ParseParams(opt);
+    std::string method = opt.get("method", "direct");
+    if(method == "logpolar")
+        job.method = ZoomVideoJob::LogPolar;
+    else if(method == "keyframe")
+        job.method = ZoomVideoJob::Keyframe;
+    else if(method != "direct")
+        throw std::runtime_error("[Batch]: Unknown zoom video method " + method);
+    opt.getSize("size", job.width, job.height);
+    job.viewWidth = opt.getInt("view-width", job.viewWidth);
+    job.targetZoom = opt.getDouble("target-zoom", job.targetZoom);
+    job.zoomRate = opt.getDouble("rate", job.zoomRate);
+    job.frames = opt.getInt("frames", job.frames);
+    job.fps = opt.getInt("fps", job.fps);
+    // --frames 0 (the default) derives the count from --target-zoom and --rate
+    if(job.fps <= 0 || job.frames < 0)
+        throw std::runtime_error("[Batch]: --fps must be positive and --frames not negative");
+    job.threads = (unsigned)opt.getInt("threads", 0);
+    job.palette = opt.get("palette", job.palette);
+    job.output = opt.get("out", job.output);
+    RenderZoomVideo(job);
+    return 0;
+}
+
+static int RunPaletteAnimation(const Options& opt)
+{
+    PaletteAnimationJob job;
+    job.params = ParseParams(opt);
+    std::string animate = opt.get("animate", "uv");
+    job.animateUV = animate == "uv" || animate == "both";
+    job.animateFreq = animate == "freq" || animate == "both";
+    if(!job.animateUV && !job.animateFreq)
+        throw std::runtime_error("[Batch]: --animate expects uv, freq or both");
+    opt.getSize("size", job.width, job.height);
+    job.viewWidth = opt.getInt("view-width", job.viewWidth);
+    job.frames = opt.getInt("frames", job.frames);
+    job.fps = opt.getInt("fps", job.fps);
+    if(job.fps <= 0 || job.frames <= 0)
+        throw std::runtime_error("[Batch]: --fps and --frames must be positive");
+    job.threads = (unsigned)opt.getInt("threads", 0);
+    job.palette = opt.get("palette", job.palette);
+    job.output = opt.get("out", job.output);
+    RenderPaletteAnimation(job);
+    return 0;
+}
+
+static int RunCluster(const Options& opt, const char* executable)
+{
+    ClusterJob job;
+    job.params = ParseParams(opt);
+    opt.getSize("size", job.width, job.height);
+    job.viewWidth = opt.getInt("view-width", job.viewWidth);
+    job.tileSize = opt.getInt("tile", job.tileSize);
+    job.bind = opt.get("bind", job.bind);
+    job.port = opt.getInt("port", job.port);
+    job.spawn = opt.getInt("spawn", job.spawn);
+    job.workerThreads = (unsigned)opt.getInt("threads", 0);
+    job.heartbeatTimeout = opt.getInt("heartbeat-timeout", job.heartbeatTimeout);
+    job.palette = opt.get("palette", job.palette);
+    job.output = opt.get("out", job.output);
+    job.executable = executable;
+    RunCoordinator(job);
+    return 0;
+}
+
+static int RunClusterWorker(const Options& opt)
+{
+    std::string address = opt.get("connect", "127.0.0.1:7600");
+    size_t colon = address.rfind(':');
+    if(colon == std::string::npos)
+        throw std::runtime_error("[Batch]: --connect expects HOST:PORT");
+    RunWorker(address.substr(0, colon), std::atoi(address.c_str() + colon + 1), (unsigned)opt.getInt("threads", 0));
+    return 0;
+}
+
+static int RunThumbnails(const Options& opt)
+{
+    ThumbnailJob job;
+    job.locations = opt.positional();
+    if(opt.has("list"))
+    {
+        std::ifstream list(opt.get("list"));
+        if(!list.is_open())
+            throw std::runtime_error("[Batch]: Could not read location list " + opt.get("list"));
+        std::string line;
+        while(std::getline(list, line))
+        {
+            if(!line.empty() && line.back() == '\r')
+                line.pop_back();
+            if(!line.empty())
+                job.locations.push_back(line);
+        }
+    }
+    opt.getSize("size", job.width, job.height);
+    job.viewWidth = opt.getInt("view-width", job.viewWidth);
+    job.threads = (unsigned)opt.getInt("threads", 0);
+    job.palette = opt.get("palette", job.palette);
+    job.output = opt.get("out", job.output);
+    job.format = opt.get("format", job.format);
+    if(job.format != "png" && job.format != "ppm")
+        throw std::runtime_error("[Batch]: --format expects png or ppm");
+    return RenderThumbnails(job) == 0 ? 0 : 1;
+}
+
+static int RunArea(const Options& opt)
+{
+    AreaResult result;
+    if(opt.has("combine"))
+    {
+        std::vector<std::string> files = opt.positional();
+        files.insert(files.begin(), opt.get("combine"));
+        result = CombineAreaResults(files);
+    }
+    else
+    {
+        AreaJob job;
+        job.samples = opt.getDouble("samples", job.samples);
+        job.iter = opt.getInt("iter", job.iter);
+        job.grid = opt.getInt("grid", job.grid);
+        job.seed = (uint64_t)opt.getDouble("seed", (double)job.seed);
+        job.threads = (unsigned)opt.getInt("threads", 0);
+        if(opt.has("shard"))
+        {
+            std::string shard = opt.get("shard");
+            if(std::sscanf(shard.c_str(), "%d/%d", &job.shard, &job.shards) != 2 || job.shard < 1 || job.shard > job.shards)
+                throw std::runtime_error("[Batch]: --shard expects I/N with 1 <= I <= N");
+            job.shard--;
+            if(!opt.has("out"))
+                throw std::runtime_error("[Batch]: --shard needs --out to store the partial result");
+        }
+        result = EstimateArea(job);
+    }
+    if(opt.has("out"))
+        SaveAreaResult(opt.get("out"), result);
+    PrintAreaResult(result);
+    return 0;
+}
+
+static int RunBuddhabrot(const Options& opt)
+{
+    BuddhabrotJob job;
+    if(opt.has("settings") || opt.has("zoom") || opt.has("offx") || opt.has("offy"))
+        job.params = ParseParams(opt);
+    else
+    {
+        // Frame the whole Buddhabrot rather than the default window view
+        job.params.zoom = 250;
+        job.params.OffX = 0.5;
+    }
+    std::string sampler = opt.get("sampler", "uniform");
+    if(sampler == "mh")
+        job.sampler = BuddhabrotJob::Metropolis;
+    else if(sampler != "uniform")
+        throw std::runtime_error("[Batch]: --sampler expects uniform or mh");
+    if(opt.has("limits"))
+    {
+        std::string limits = opt.get("limits");
+        int n = std::sscanf(limits.c_str(), "%d,%d,%d", &job.limits[0], &job.limits[1], &job.limits[2]);
+        if(n == 1)
+            job.limits[1] = job.limits[2] = job.limits[0];
+        else if(n != 3)
+            throw std::runtime_error("[Batch]: --limits expects R,G,B or a single limit");
+    }
+    opt.getSize("size", job.width, job.height);
+    job.viewWidth = opt.getInt("view-width", job.viewWidth);
+    job.minIter = opt.getInt("min-iter", job.minIter);
+    job.samples = opt.getDouble("samples", job.samples);
+    job.seed = (uint64_t)opt.getDouble("seed", (double)job.seed);
+    job.gamma = opt.getDouble("gamma", job.gamma);
+    job.snapshotInterval = opt.getInt("snapshot", job.snapshotInterval);
+    job.threads = (unsigned)opt.getInt("threads", 0);
+    job.output = opt.get("out", job.output);
+    RenderBuddhabrot(job);
+    return 0;
+}
+
+static int RunBench(const Options& opt)
+{
+    BenchJob job;
+    opt.getSize("size", job.width, job.height);
+    job.repeat = opt.getInt("repeat", job.repeat);
+    for(const std::string& t : SplitList(opt.get("threads")))
+        job.threads.push_back((unsigned)std::atoi(t.c_str()));
+    job.views = SplitList(opt.get("views"));
+    job.kernels = SplitList(opt.get("kernels"));
+    job.counters = opt.has("counters");
+    job.json = opt.get("json");
+    RunBenchmark(job);
+    return 0;
+}
+
+static int RunGoldenCheck(const Options& opt)
+{
+    GoldenJob job;
+    job.dir = opt.get("dir", job.dir);
+    job.budgets = opt.get("budgets", job.budgets);
+    opt.getSize("size", job.width, job.height);
+    job.threads = (unsigned)opt.getInt("threads", 0);
+    job.repeat = opt.getInt("repeat", job.repeat);
+    job.views = SplitList(opt.get("views"));
+    job.kernels = SplitList(opt.get("kernels"));
+    job.update = opt.has("update");
+    job.tolerance = opt.getDouble("tolerance", job.tolerance);
+    job.maxError = opt.getInt("max-error", job.maxError);
+    job.margin = opt.getDouble("margin", job.margin);
+    job.headroom = opt.getDouble("headroom", job.headroom);
+    return RunGolden(job) == 0 ? 0 : 1;
+}
+
+static int RunVerifyCheck(const Options& opt)
+{
+    VerifyJob job;
+    opt.getSize("size", job.width, job.height);
+    job.threads = (unsigned)opt.getInt("threads", 0);
+    job.views = SplitList(opt.get("views"));
+    job.kernels = SplitList(opt.get("kernels"));
+    job.samples = opt.getInt("samples", job.samples);
+    job.seed = (uint64_t)opt.getInt("seed", (int)job.seed);
+    job.tolerance = opt.getDouble("tolerance", job.tolerance);
+    return RunVerify(job) == 0 ? 0 : 1;
+}
+
+static int RunTune(const Options& opt)
+{
+    std::string path = opt.get("out", "tuning.txt");
+    SaveTuning(path, AutoTune());
+    std::cout << "[Tune]: saved to " << path << std::endl;
+    return 0;
+}
+
+static void PrintUsage()
+{
+    std::cout <<
+        "Usage: MandelbrotSet [command] [options]\n"
+        "Without a command the interactive window is opened.\n\n"
+        "View options (all commands):\n"
+        "  --settings FILE   load iter/zoom/offset/freq/UVoffset (settings.txt format)\n"
+        "  --iter N  --zoom Z  --offx X  --offy Y  --freq F  --uvoffset U\n"
+        "  --palette FILE    gradient texture (default img/pal.png)\n"
+        "  --threads N       worker threads (default: all)\n"
+        "  --trace FILE      write a Chrome trace of the run (builds with MANDELBROT_PROFILE)\n\n"
+        "poster              render a large image in strips streamed to disk\n"
+        "  --size WxH  --out FILE(.png|.ppm)  --strip ROWS  --tile COLS  --view-width W\n"
+        "  --tile-height ROWS  tile rows within a strip; the strip height is never tuned, as the\n"
+        "                    output bytes and the checkpoint depend on it\n"
+        "  --checkpoint FILE  --checkpoint-interval SEC (0 = off)  --restart\n"
+        "                    an interrupted poster resumes from its checkpoint when rerun\n"
+        "  --heatmap         also write per-tile compute time and iterations as images\n"
+        "  --kernel NAME     CPU kernel (scalar, batched)\n"
+        "  --tuning FILE     tuned kernel/tile shape/threads, measured on first use (default tuning.txt)\n"
+        "  --no-tune         use the defaults instead; explicit options always win\n"
+        "pyramid             export a deep-zoom tile pyramid, resuming from existing tiles\n"
+        "  --size WxH  --out NAME  --layout dzi|xyz  --tile SIZE  --overlap PX  --view-width W\n"
+        "zoomvideo           render the auto zoom as a .y4m video (--out - for stdout)\n"
+        "  --size WxH  --out FILE  --target-zoom Z  --rate R  --frames N  --fps N  --view-width W\n"
+        "  --method direct|logpolar|keyframe\n"
+        "                    logpolar resamples every frame from one exponential-map strip,\n"
+        "                    keyframe crops frames from 2x keyframes rendered at every zoom doubling\n"
+        "                    (both only zoom in: --rate above 1)\n"
+        "palettevideo        export the UV/frequency color animation as .y4m from a single render\n"
+        "  --size WxH  --out FILE  --animate uv|freq|both  --frames N  --fps N  --view-width W\n"
+        "cluster             coordinate a poster render across worker processes\n"
+        "  --size WxH  --out FILE  --tile SIZE  --bind ADDR  --port N  --heartbeat-timeout SEC\n"
+        "  --spawn N         start N local workers (--threads then applies to each worker)\n"
+        "worker              render tiles for a coordinator\n"
+        "  --connect HOST:PORT\n"
+        "thumbs [FILES...]   render a thumbnail for each settings file, many at once\n"
+        "  --list FILE       read the settings files from FILE, one per line\n"
+        "  --size WxH  --out DIR  --format png|ppm  --view-width W\n"
+        "area                Monte Carlo estimate of the area of the set with error bars\n"
+        "  --samples N  --iter N (default 10000)  --grid STRATA_PER_SIDE  --seed N\n"
+        "  --shard I/N --out FILE   compute one of N interleaved parts, e.g. in separate processes\n"
+        "  --combine FILES...       merge the parts into the final estimate\n"
+        "buddha              Buddhabrot / Nebulabrot orbit density image\n"
+        "  --size WxH  --out FILE  --samples N  --limits R,G,B (one value = grayscale)\n"
+        "  --min-iter N  --gamma G  --seed N  --view-width W\n"
+        "  --sampler uniform|mh   mh (Metropolis) converges far faster on zoomed views\n"
+        "  --snapshot SEC    rewrite the output with the current state every SEC seconds\n"
+        "bench               time the CPU kernels on canonical views (default, seahorse, deep, interior)\n"
+        "  --size WxH  --repeat N  --threads 1,2,4  --views A,B  --kernels A,B\n"
+        "  --counters        add cycles, instructions, IPC, branch and cache misses (Linux perf)\n"
+        "  --json FILE       write the results as JSON (- for stdout)\n"
+        "golden              check every CPU kernel against stored iteration buffers and time budgets\n"
+        "  --dir DIR  --size WxH  --repeat N  --views A,B  --kernels A,B\n"
+        "  --budgets FILE    time budgets (default golden_budgets.txt), missing ones are recorded\n"
+        "                    from the median of 3x --repeat runs plus --headroom (default 0.5)\n"
+        "  --update          store the reference kernel's output and the current times instead\n"
+        "  --tolerance F     fraction of pixels allowed to differ (default 0)\n"
+        "  --max-error N     by at most N iterations (default 0)\n"
+        "  --margin F        allowed slowdown over the budget, 0.5 = 50% (negative: no time check)\n"
+        "                    exits with status 1 when a check fails\n"
+        "verify              compare the CPU kernels pixel by pixel, and random pixels against\n"
+        "                    an extended precision (__float128 / long double) reference\n"
+        "  --size WxH  --views A,B  --kernels A,B  --samples N  --seed N\n"
+        "  --tolerance F     fraction of samples allowed to differ from the reference (default 1)\n"
+        "                    exits with status 1 when kernels disagree or the tolerance is exceeded\n"
+        "tune                measure the fastest kernel, tile shape and thread count for this machine\n"
+        "  --out FILE        tuning file to write (default tuning.txt)\n";
+}
+
+bool IsBatchCommand(const char* arg)
+{
+    return std::strcmp(arg, "poster") == 0
+        || std::strcmp(arg, "pyramid") == 0
+        || std::strcmp(arg, "zoomvideo") == 0
+        || std::strcmp(arg, "palettevideo") == 0
+        || std::strcmp(arg, "cluster") == 0
+        || std::strcmp(arg, "worker") == 0
+        || std::strcmp(arg, "thumbs") == 0
+        || std::strcmp(arg, "area") == 0
+        || std::strcmp(arg, "buddha") == 0
+        || std::strcmp(arg, "bench") == 0
+        || std::strcmp(arg, "tune") == 0
+        || std::strcmp(arg, "golden") == 0
+        || std::strcmp(arg, "verify") == 0
+        || std::strcmp(arg, "help") == 0;
+}
+
+static int RunCommand(const std::string& command, const Options& opt, char** argv)
+{
+    if(command == "poster")
+        return RunPoster(opt);
+    if(command == "pyramid")
+        return RunPyramid(opt);
+    if(command == "zoomvideo")
+        return RunZoomVideo(opt);
+    if(command == "palettevideo")
+        return RunPaletteAnimation(opt);
+    if(command == "cluster")
+        return RunCluster(opt, argv[0]);
+    if(command == "worker")
+        return RunClusterWorker(opt);
+    if(command == "thumbs")
+        return RunThumbnails(opt);
+    if(command == "area")
+        return RunArea(opt);
+    if(command == "buddha")
+        return RunBuddhabrot(opt);
+    if(command == "bench")
+        return RunBench(opt);
+    if(command == "tune")
+        return RunTune(opt);
+    if(command == "golden")
+        return RunGoldenCheck(opt);
+    if(command == "verify")
+        return RunVerifyCheck(opt);
+
+    PrintUsage();
+    return 0;
+}
+
+int RunBatch(int argc, char** argv)
+{
+    std::string command = argv[1];
+    Options opt(argc, argv, 2);
+    PROFILE_THREAD_NAME("main");
+
+    std::string trace = opt.get("trace");
+    if(!trace.empty() && !Profiler::Enabled())
+        throw std::runtime_error("[Batch]: --trace needs a build with -DMANDELBROT_PROFILE=ON");
+
+    int result = RunCommand(command, opt, argv);
+    if(!trace.empty())
+    {
+        if(!Profiler::WriteChromeTrace(trace))
+            throw std::runtime_error("[Batch]: Could not write trace " + trace);
+        std::cout << "[Batch]: trace written to " << trace << std::endl;
+    }
+    return result;
+}
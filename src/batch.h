@@ -0,0 +1,9 @@
+#ifndef MANDELBROTSET_BATCH_H
+#define MANDELBROTSET_BATCH_H
+
+// Headless modes selected by the first command line argument (e.g. "poster").
+// They run without creating a window.
+bool IsBatchCommand(const char* arg);
+int RunBatch(int argc, char** argv);
+
+#endif //MANDELBROTSET_BATCH_H
@@ -0,0 +1,343 @@
+#include "bench.h"
+#include "fractal.h"
+#include "threadpool.h"
+#include "perfcounters.h"
+#include "iterstats.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <memory>
+#include <cstdio>
+
+namespace
+{
+    typedef Fractal::KernelInfo BenchKernel;
+
+    struct BenchView : CanonicalView
+    {
+        IterationStats stats;   // of the first kernel, filled by the warm-up render
+
+        explicit BenchView(const CanonicalView& view) : CanonicalView(view) {}
+    };
+
+    struct BenchResult
+    {
+        std::string kernel, view;
+        unsigned threads;
+        double seconds;
+        uint64_t iterations;
+        double speedup;     // against the same kernel and view on one thread
+        PerfCounts counts;  // summed over the worker threads
+    };
+
+    // One row strip per job; rows keep neighbouring pixels, and so similar costs, together
+    // Counters are opened by each worker on its first strip and only count the kernel.
+    // With `stats`, every worker also reduces the strips it rendered into its own statistics.
+    double RenderOnce(const BenchKernel& kernel, const FractalParams& params, int width, int height,
+                      ThreadPool& pool, std::vector<uint32_t>& image, uint64_t& iterations,
+                      std::vector<std::unique_ptr<PerfCounters>>* counters, PerfCounts& counts,
+                      IterationStats* stats = nullptr)
+    {
+        const int StripRows = 8;
+        const int strips = (height + StripRows - 1) / StripRows;
+        std::vector<uint64_t> perWorker(pool.size(), 0);
+        std::vector<PerfCounts> perWorkerCounts(pool.size());
+        std::vector<IterationStats> perWorkerStats(pool.size(), IterationStats(params.iter));
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        pool.parallelFor(strips, [&](int s, unsigned worker)
+        {
+            int y0 = s * StripRows;
+            int rows = std::min(StripRows, height - y0);
+            PerfCounters* perf = nullptr;
+            if(counters)
+            {
+                if(!(*counters)[worker])
+                    (*counters)[worker].reset(new PerfCounters());
+                perf = (*counters)[worker].get();
+                perf->start();
+            }
+            perWorker[worker] += kernel.render(params, width, height, 0, y0, width, rows,
+                                               image.data() + (size_t)y0 * width, width);
+            if(perf)
+                perWorkerCounts[worker] += perf->stop();
+            if(stats)
+                perWorkerStats[worker].add(image.data() + (size_t)y0 * width, (size_t)width * rows);
+        });
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        iterations = 0;
+        counts = PerfCounts();
+        for(unsigned w = 0; w < pool.size(); w++)
+        {
+            iterations += perWorker[w];
+            if(perWorkerCounts[w].available)
+                counts += perWorkerCounts[w];
+        }
+        if(stats)
+        {
+            *stats = IterationStats(params.iter);
+            for(const IterationStats& s : perWorkerStats)
+                *stats += s;
+        }
+        return seconds;
+    }
+
+    std::string CompilerName()
+    {
+        std::ostringstream ss;
+#if defined(__clang__)
+        ss << "clang " << __clang_major__ << "." << __clang_minor__ << "." << __clang_patchlevel__;
+#elif defined(__GNUC__)
+        ss << "gcc " << __GNUC__ << "." << __GNUC_MINOR__ << "." << __GNUC_PATCHLEVEL__;
+#elif defined(_MSC_VER)
+        ss << "msvc " << _MSC_VER;
+#else
+        ss << "unknown";
+#endif
+        return ss.str();
+    }
+
+    void WriteJson(std::ostream& out, const BenchJob& job, const std::vector<BenchView>& views,
+                   const std::vector<BenchResult>& results, const std::string& countersError)
+    {
+        const double pixels = (double)job.width * job.height;
+        out << "{\n"
+            << "  \"version\": 1,\n"
+            << "  \"compiler\": \"" << CompilerName() << "\",\n"
+            << "  \"built\": \"" << __DATE__ << " " << __TIME__ << "\",\n"
+            << "  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n"
+            << "  \"width\": " << job.width << ",\n"
+            << "  \"height\": " << job.height << ",\n"
+            << "  \"repeat\": " << job.repeat << ",\n";
+        if(job.counters)
+            out << "  \"counters_error\": \"" << countersError << "\",\n";
+        out << "  \"views\": [";
+        for(size_t i = 0; i < views.size(); i++)
+        {
+            const FractalParams& p = views[i].params;
+            char line[512];
+            const IterationStats& st = views[i].stats;
+            std::snprintf(line, sizeof(line),
+                          "%s\n    { \"name\": \"%s\", \"description\": \"%s\", \"iter\": %d, \"zoom\": %.17g, "
+                          "\"offx\": %.17g, \"offy\": %.17g,\n      \"stats\": { \"pixels\": %llu, \"bounded\": %llu, "
+                          "\"bounded_fraction\": %.6f, \"iterations\": %llu, \"mean_escape\": %.3f, \"max_escape\": %u, "
+                          "\"histogram\": [",
+                          i ? "," : "", views[i].name, views[i].description, p.iter, p.zoom, p.OffX, p.OffY,
+                          (unsigned long long)st.pixels, (unsigned long long)st.bounded, st.boundedFraction(),
+                          (unsigned long long)st.total, st.meanEscape(), st.maxEscape);
+            out << line;
+            for(int b = 0; b < IterationStats::Bins; b++)
+                out << (b ? ", " : "") << st.histogram[b];
+            out << "] } }";
+        }
+        out << "\n  ],\n"
+            << "  \"results\": [";
+        for(size_t i = 0; i < results.size(); i++)
+        {
+            const BenchResult& r = results[i];
+            char line[512];
+            std::snprintf(line, sizeof(line),
+                          "%s\n    { \"kernel\": \"%s\", \"view\": \"%s\", \"threads\": %u, \"seconds\": %.6f, "
+                          "\"iterations\": %llu, \"mpix_per_s\": %.3f, \"giter_per_s\": %.4f, \"speedup\": %.3f",
+                          i ? "," : "", r.kernel.c_str(), r.view.c_str(), r.threads, r.seconds,
+                          (unsigned long long)r.iterations, pixels / r.seconds * 1e-6, r.iterations / r.seconds * 1e-9,
+                          r.speedup);
+            out << line;
+            if(r.counts.available)
+            {
+                out << ", \"counters\": {";
+                const char* separator = " ";
+                for(int e = 0; e < PerfEventCount; e++)
+                {
+                    if(!r.counts.has(e))
+                        continue;
+                    out << separator << "\"" << PerfEventName(e) << "\": " << r.counts.value[e];
+                    separator = ", ";
+                }
+                if(r.counts.ipc() > 0)
+                    out << separator << "\"ipc\": " << r.counts.ipc();
+                out << " }";
+            }
+            out << " }";
+        }
+        out << "\n  ]\n}\n";
+    }
+
+    template<typename T>
+    bool Selected(const std::vector<std::string>& names, const T& item)
+    {
+        return names.empty() || std::find(names.begin(), names.end(), item.name) != names.end();
+    }
+}
+
+std::vector<CanonicalView> CanonicalViews()
+{
+    std::vector<CanonicalView> views(4);
+    views[0].name = "default";
+    views[0].description = "startup view of the window";
+
+    views[1].name = "seahorse";
+    views[1].description = "boundary of the seahorse valley";
+    views[1].params.iter = 1000;
+    views[1].params.zoom = 20000;
+    views[1].params.OffX = 0.745;
+    views[1].params.OffY = -0.11;
+
+    views[2].name = "deep";
+    views[2].description = "zoom near the limit of double precision";
+    views[2].params.iter = 5000;
+    views[2].params.zoom = 1e12;
+    views[2].params.OffX = 0.743643887037151;
+    views[2].params.OffY = -0.131825904205330;
+
+    views[3].name = "interior";
+    views[3].description = "mostly points of the set, every one reaching the limit";
+    views[3].params.iter = 2000;
+    views[3].params.zoom = 400;
+    views[3].params.OffX = 0.3;
+    return views;
+}
+
+void RunBenchmark(const BenchJob& job)
+{
+    if(job.width <= 0 || job.height <= 0 || job.repeat <= 0)
+        throw std::runtime_error("[Bench]: Invalid job");
+
+    std::vector<unsigned> threadCounts = job.threads;
+    if(threadCounts.empty())
+    {
+        unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+        for(unsigned t = 1; t < hardware; t *= 2)
+            threadCounts.push_back(t);
+        threadCounts.push_back(hardware);
+    }
+
+    std::vector<BenchView> views;
+    for(const CanonicalView& view : CanonicalViews())
+        if(Selected(job.views, view))
+            views.push_back(BenchView(view));
+    std::vector<BenchKernel> kernels;
+    for(int k = 0; k < Fractal::KernelCount; k++)
+        if(Selected(job.kernels, Fractal::Kernels[k]))
+            kernels.push_back(Fractal::Kernels[k]);
+    if(views.empty() || kernels.empty())
+        throw std::runtime_error("[Bench]: No view or kernel matches the selection");
+
+    // The table goes to stderr when stdout carries the JSON
+    FILE* log = job.json == "-" ? stderr : stdout;
+    std::fprintf(log, "[Bench]: %dx%d, best of %d\n", job.width, job.height, job.repeat);
+    // Speedups are always against one thread, timed separately when the list does not start with it
+    const bool baseline = threadCounts.front() != 1;
+    if(baseline)
+        std::fprintf(log, "[Bench]: speedup against an unlisted 1-thread run\n");
+    std::string countersError;
+    if(job.counters)
+    {
+        // Probe once on this thread so an unavailable PMU is reported up front
+        PerfCounters probe;
+        countersError = probe.error();
+        if(!probe.available())
+            std::fprintf(log, "[Bench]: hardware counters unavailable (%s)\n", countersError.c_str());
+    }
+    std::fprintf(log, "%-8s %-10s %7s %10s %10s %10s %8s", "kernel", "view", "threads", "seconds", "Mpix/s", "Giter/s", "speedup");
+    if(job.counters)
+        std::fprintf(log, " %6s %12s %12s", "IPC", "br-miss/kit", "$-miss/kit");
+    std::fprintf(log, "\n");
+
+    std::vector<uint32_t> image((size_t)job.width * job.height);
+    std::vector<BenchResult> results;
+    for(const BenchKernel& kernel : kernels)
+    {
+        for(BenchView& view : views)
+        {
+            FractalParams params = view.params;
+            params.zoom *= job.width / 800.0;
+
+            // Untimed warm-up, which also gathers the iteration statistics of the view
+            {
+                ThreadPool pool(threadCounts.back());
+                uint64_t iterations;
+                PerfCounts counts;
+                IterationStats stats;
+                RenderOnce(kernel, params, job.width, job.height, pool, image, iterations, nullptr, counts, &stats);
+                if(&kernel == &kernels.front())
+                {
+                    view.stats = stats;
+                    std::fprintf(log, "[Bench]: %s: %.2f%% of pixels reach iter %d, escapes average %.1f (max %u) iterations\n",
+                                 view.name, view.stats.boundedFraction() * 100, params.iter, view.stats.meanEscape(),
+                                 view.stats.maxEscape);
+                }
+            }
+
+            double single = 0;
+            if(baseline)
+            {
+                ThreadPool pool(1);
+                for(int i = 0; i < job.repeat; i++)
+                {
+                    uint64_t iterations;
+                    PerfCounts counts;
+                    double seconds = RenderOnce(kernel, params, job.width, job.height, pool, image, iterations,
+                                                nullptr, counts);
+                    if(i == 0 || seconds < single)
+                        single = seconds;
+                }
+            }
+            for(unsigned threads : threadCounts)
+            {
+                ThreadPool pool(threads);
+                std::vector<std::unique_ptr<PerfCounters>> counters(pool.size());
+                BenchResult r;
+                r.kernel = kernel.name;
+                r.view = view.name;
+                r.threads = pool.size();
+                r.seconds = 0;
+                for(int i = 0; i < job.repeat; i++)
+                {
+                    uint64_t iterations;
+                    PerfCounts counts;
+                    double seconds = RenderOnce(kernel, params, job.width, job.height, pool, image, iterations,
+                                                job.counters ? &counters : nullptr, counts);
+                    if(i == 0 || seconds < r.seconds)
+                    {
+                        r.seconds = seconds;
+                        r.counts = counts;
+                    }
+                    r.iterations = iterations;
+                }
+                if(r.threads == 1)
+                    single = r.seconds;
+                r.speedup = single / r.seconds;
+
+                std::fprintf(log, "%-8s %-10s %7u %10.4f %10.2f %10.4f %8.2f", r.kernel.c_str(), r.view.c_str(),
+                            r.threads, r.seconds, (double)job.width * job.height / r.seconds * 1e-6,
+                            r.iterations / r.seconds * 1e-9, r.speedup);
+                if(job.counters)
+                {
+                    double kiloIterations = std::max<double>(1, r.iterations * 1e-3);
+                    std::fprintf(log, " %6.2f %12.3f %12.3f", r.counts.ipc(),
+                                 r.counts.value[PerfBranchMisses] / kiloIterations,
+                                 r.counts.value[PerfCacheMisses] / kiloIterations);
+                }
+                std::fprintf(log, "\n");
+                results.push_back(r);
+            }
+        }
+    }
+
+    if(job.json == "-")
+        WriteJson(std::cout, job, views, results, countersError);
+    else if(!job.json.empty())
+    {
+        std::ofstream out(job.json, std::ios::trunc);
+        WriteJson(out, job, views, results, countersError);
+        if(!out)
+            throw std::runtime_error("[Bench]: Could not write " + job.json);
+        std::cout << "[Bench]: results written to " << job.json << std::endl;
+    }
+}
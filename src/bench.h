@@ -0,0 +1,34 @@
+#ifndef MANDELBROTSET_BENCH_H
+#define MANDELBROTSET_BENCH_H
+
+#include <string>
+#include <vector>
+#include "fractal.h"
+
+// Views covering the typical cost profiles, shared by bench and golden
+struct CanonicalView
+{
+    const char* name;
+    const char* description;
+    FractalParams params;   // framed for an 800 pixel wide window
+};
+
+// default, seahorse, deep, interior
+std::vector<CanonicalView> CanonicalViews();
+
+// Renders a fixed set of views with every CPU kernel at a fixed resolution and
+// several thread counts, so numbers can be compared across builds and machines
+struct BenchJob
+{
+    int width = 640, height = 360;
+    int repeat = 3;                     // the best of this many runs is reported
+    std::vector<unsigned> threads;      // empty = 1, 2, 4, ... up to all hardware threads
+    std::vector<std::string> views;     // empty = all
+    std::vector<std::string> kernels;   // empty = all
+    bool counters = false;              // read hardware counters around every strip
+    std::string json;                   // file for the JSON report, "-" for stdout, empty for none
+};
+
+void RunBenchmark(const BenchJob& job);
+
+#endif //MANDELBROTSET_BENCH_H
@@ -0,0 +1,51 @@
+#ifndef MANDELBROTSET_BOUNDEDQUEUE_H
+#define MANDELBROTSET_BOUNDEDQUEUE_H
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+// Blocking FIFO with a fixed capacity, used to pipeline producer and consumer threads
+template<typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(size_t capacity) : m_capacity(capacity) {}
+
+    void push(T value)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_notFull.wait(lock, [this]{ return m_items.size() < m_capacity; });
+        m_items.push_back(std::move(value));
+        m_notEmpty.notify_one();
+    }
+
+    // Returns false once the queue is closed and drained
+    bool pop(T& value)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_notEmpty.wait(lock, [this]{ return m_closed || !m_items.empty(); });
+        if(m_items.empty())
+            return false;
+        value = std::move(m_items.front());
+        m_items.pop_front();
+        m_notFull.notify_one();
+        return true;
+    }
+
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closed = true;
+        m_notEmpty.notify_all();
+    }
+
+private:
+    std::deque<T> m_items;
+    size_t m_capacity;
+    bool m_closed = false;
+    std::mutex m_mutex;
+    std::condition_variable m_notFull, m_notEmpty;
+};
+
+#endif //MANDELBROTSET_BOUNDEDQUEUE_H
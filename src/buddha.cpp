@@ -0,0 +1,421 @@
+#include "buddha.h"
+#include "threadpool.h"
+#include "imagewriter.h"
+#include "fileutil.h"
+#include "random.h"
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+#include <cstdio>
+
+namespace
+{
+    // Inverse of Fractal::PixelToComplex: c -> pixel containing it
+    struct ViewMapping
+    {
+        double zoom, offX, offY;
+        int width, height;
+
+        ViewMapping(const FractalParams& params, int w, int h)
+            : zoom(params.zoom), offX(params.OffX), offY(params.OffY), width(w), height(h) {}
+
+        bool toPixel(double cx, double cy, int& px, int& py) const
+        {
+            double fx = (cx + offX) * zoom + width / 2.0;
+            double fy = (cy + offY) * zoom + height / 2.0;
+            double row = height - fy;
+            if(fx < 0 || row < 0 || fx >= width || row >= height)
+                return false;
+            px = (int)fx;
+            py = (int)row;
+            return true;
+        }
+    };
+
+    // Points of the cardioid and the period-2 bulb never escape
+    bool InMainComponents(double cx, double cy)
+    {
+        double qx = cx - 0.25;
+        double q = qx*qx + cy*cy;
+        return q * (q + qx) <= 0.25 * cy*cy || (cx + 1.0)*(cx + 1.0) + cy*cy <= 0.0625;
+    }
+
+    // Iterates c up to maxIter times keeping the orbit. Returns the number of
+    // orbit points before escape, or -1 if the point did not escape.
+    int TraceOrbit(double cx, double cy, int maxIter, double* orbit, int& spent)
+    {
+        spent = 0;
+        if(InMainComponents(cx, cy))
+            return -1;
+        double x = 0, y = 0;
+        for(int i = 0; i < maxIter; i++)
+        {
+            double zx = x*x - y*y + cx;
+            double zy = 2.0 * x * y + cy;
+            spent = i + 1;
+            if(zx*zx + zy*zy > 4.0)
+                return i;
+            x = zx;
+            y = zy;
+            orbit[2*i] = x;
+            orbit[2*i + 1] = y;
+        }
+        return -1;
+    }
+
+    // Adds the orbit (and its mirror image, the orbit of conj(c)) to every
+    // channel whose limit it escaped within
+    void Splat(const ViewMapping& view, const double* orbit, int length, const int* limits, float weight, float* counts)
+    {
+        float channels[3];
+        for(int ch = 0; ch < 3; ch++)
+            channels[ch] = length < limits[ch] ? weight : 0.0f;
+        for(int i = 0; i < length; i++)
+        {
+            int px, py;
+            for(int mirror = 0; mirror < 2; mirror++)
+            {
+                double y = mirror ? -orbit[2*i + 1] : orbit[2*i + 1];
+                if(!view.toPixel(orbit[2*i], y, px, py))
+                    continue;
+                float* pixel = counts + ((size_t)py * view.width + px) * 3;
+                for(int ch = 0; ch < 3; ch++)
+                    pixel[ch] += channels[ch];
+            }
+        }
+    }
+
+    // Number of orbit points (with the mirror orbit) that land in the view
+    int Contribution(const ViewMapping& view, const double* orbit, int length)
+    {
+        int n = 0, px, py;
+        for(int i = 0; i < length; i++)
+            n += view.toPixel(orbit[2*i], orbit[2*i + 1], px, py) + view.toPixel(orbit[2*i], -orbit[2*i + 1], px, py);
+        return n;
+    }
+
+    // Metropolis-Hastings chain over c whose stationary density is proportional to
+    // the contribution F(c) of its orbit to the view. Each step adds the current
+    // orbit with weight 1/F, which keeps the image an unbiased orbit density while
+    // the samples concentrate on the few points whose orbits cross a zoomed view.
+    class MetropolisChain
+    {
+    public:
+        MetropolisChain(const ViewMapping& view, const BuddhabrotJob& job, int maxIter, uint64_t seed)
+            : m_view(view), m_job(job), m_maxIter(maxIter), m_random(seed),
+              m_orbit((size_t)maxIter * 2), m_candidate((size_t)maxIter * 2)
+        {
+            m_viewWidth = view.width / view.zoom;
+            m_viewHeight = view.height / view.zoom;
+            m_viewX = -view.offX - m_viewWidth / 2;
+            m_viewY = -view.offY - m_viewHeight / 2;
+        }
+
+        // Finds a contributing starting point and lets the chain forget it
+        void start(uint64_t& iterations)
+        {
+            const int Attempts = 1000000;
+            for(int i = 0; i < Attempts && m_contribution == 0; i++)
+            {
+                double cx, cy;
+                sampleIndependent(cx, cy);
+                int spent;
+                m_contribution = evaluate(cx, cy, m_orbit.data(), m_length, spent);
+                iterations += spent;
+                m_cx = cx;
+                m_cy = cy;
+            }
+            if(m_contribution == 0)
+                throw std::runtime_error("[Buddhabrot]: No escaping orbit found that crosses the view");
+            const int BurnIn = 1000;
+            run(BurnIn, nullptr, iterations);
+            m_accepted = m_proposed = 0;
+        }
+
+        // Advances the chain; counts is null during burn-in
+        void run(uint64_t steps, float* counts, uint64_t& iterations)
+        {
+            const double LargeMutation = 0.2;
+            // Small mutations span 1e-4 to 0.1 of the view width on a log scale
+            const double R1 = m_viewWidth * 1e-4, R2 = m_viewWidth * 0.1;
+            const double Pi = 3.14159265358979323846;
+
+            for(uint64_t s = 0; s < steps; s++)
+            {
+                double cx, cy;
+                bool large = m_random.uniform() < LargeMutation;
+                if(large)
+                    sampleIndependent(cx, cy);
+                else
+                {
+                    double r = R2 * std::exp(-std::log(R2 / R1) * m_random.uniform());
+                    double a = 2.0 * Pi * m_random.uniform();
+                    cx = m_cx + r * std::cos(a);
+                    cy = m_cy + r * std::sin(a);
+                }
+
+                int length, spent;
+                int contribution = evaluate(cx, cy, m_candidate.data(), length, spent);
+                iterations += spent;
+                m_proposed++;
+                m_weight += 1.0;
+
+                if(contribution > 0)
+                {
+                    double alpha = (double)contribution / m_contribution;
+                    if(large)
+                        alpha *= independentDensity(m_cx, m_cy) / independentDensity(cx, cy);
+                    if(m_random.uniform() < alpha)
+                    {
+                        // The outgoing state is splatted once for all the steps it was kept
+                        flush(counts);
+                        m_orbit.swap(m_candidate);
+                        m_cx = cx;
+                        m_cy = cy;
+                        m_length = length;
+                        m_contribution = contribution;
+                        m_accepted++;
+                    }
+                }
+            }
+            flush(counts);
+        }
+
+        uint64_t accepted() const { return m_accepted; }
+        uint64_t proposed() const { return m_proposed; }
+
+    private:
+        int evaluate(double cx, double cy, double* orbit, int& length, int& spent)
+        {
+            length = TraceOrbit(cx, cy, m_maxIter, orbit, spent);
+            if(length < m_job.minIter)
+                return 0;
+            return Contribution(m_view, orbit, length);
+        }
+
+        // Large mutations: half uniform over |Re|, |Im| <= 2, half uniform over the view.
+        // The view half guarantees contributing proposals however deep the zoom.
+        void sampleIndependent(double& cx, double& cy)
+        {
+            if(m_random.uniform() < 0.5)
+            {
+                cx = m_random.uniform() * 4.0 - 2.0;
+                cy = m_random.uniform() * 4.0 - 2.0;
+            }
+            else
+            {
+                cx = m_viewX + m_random.uniform() * m_viewWidth;
+                cy = m_viewY + m_random.uniform() * m_viewHeight;
+            }
+        }
+
+        double independentDensity(double cx, double cy) const
+        {
+            double density = std::fabs(cx) <= 2.0 && std::fabs(cy) <= 2.0 ? 0.5 / 16.0 : 0.0;
+            if(cx >= m_viewX && cx < m_viewX + m_viewWidth && cy >= m_viewY && cy < m_viewY + m_viewHeight)
+                density += 0.5 / (m_viewWidth * m_viewHeight);
+            return density;
+        }
+
+        void flush(float* counts)
+        {
+            if(counts && m_weight > 0)
+                Splat(m_view, m_orbit.data(), m_length, m_job.limits, (float)(m_weight / m_contribution), counts);
+            m_weight = 0;
+        }
+
+        const ViewMapping& m_view;
+        const BuddhabrotJob& m_job;
+        int m_maxIter;
+        Random m_random;
+        std::vector<double> m_orbit, m_candidate;
+        double m_viewX, m_viewY, m_viewWidth, m_viewHeight;
+        double m_cx = 0, m_cy = 0;
+        int m_length = 0;
+        int m_contribution = 0;
+        double m_weight = 0;    // steps spent in the current state and not splatted yet
+        uint64_t m_accepted = 0, m_proposed = 0;
+    };
+
+    // Scales each channel so that its 99.9th percentile of the non-zero counts is white
+    void ToneMap(const std::vector<double>& counts, double gamma, std::vector<uint8_t>& rgb)
+    {
+        rgb.resize(counts.size());
+        for(int ch = 0; ch < 3; ch++)
+        {
+            std::vector<double> values;
+            for(size_t i = ch; i < counts.size(); i += 3)
+                if(counts[i] > 0)
+                    values.push_back(counts[i]);
+            double white = 1;
+            if(!values.empty())
+            {
+                size_t k = std::min(values.size() - 1, (size_t)(values.size() * 0.999));
+                std::nth_element(values.begin(), values.begin() + k, values.end());
+                white = values[k];
+            }
+            for(size_t i = ch; i < counts.size(); i += 3)
+            {
+                double v = std::min(1.0, counts[i] / white);
+                rgb[i] = (uint8_t)(std::pow(v, gamma) * 255.0 + 0.5);
+            }
+        }
+    }
+
+    void WriteSnapshot(const BuddhabrotJob& job, const std::vector<double>& counts, unsigned threads)
+    {
+        std::vector<uint8_t> rgb;
+        ToneMap(counts, job.gamma, rgb);
+        // Written aside and renamed so a viewer never sees a half written file
+        std::string part = job.output + ".part";
+        size_t dot = job.output.rfind('.');
+        if(dot != std::string::npos)
+            part = job.output.substr(0, dot) + ".part" + job.output.substr(dot);
+        WriteImage(part, job.width, job.height, rgb.data(), threads);
+        RenameFile(part, job.output);
+    }
+}
+
+void RenderBuddhabrot(const BuddhabrotJob& job)
+{
+    if(job.width <= 0 || job.height <= 0 || job.samples < 1)
+        throw std::runtime_error("[Buddhabrot]: Invalid job");
+    for(int limit : job.limits)
+        if(limit <= 0)
+            throw std::runtime_error("[Buddhabrot]: Iteration limits must be positive");
+
+    typedef std::chrono::steady_clock Clock;
+
+    FractalParams params = job.params;
+    params.zoom *= (double)job.width / job.viewWidth;
+    const ViewMapping view(params, job.width, job.height);
+    const int maxIter = *std::max_element(job.limits, job.limits + 3);
+
+    ThreadPool pool(job.threads);
+    const unsigned threads = pool.size();
+    // Per-thread counters, 3 channels interleaved per pixel
+    std::vector<std::vector<float>> histograms(threads, std::vector<float>((size_t)job.width * job.height * 3, 0.0f));
+    std::vector<std::vector<double>> orbits(threads, std::vector<double>((size_t)maxIter * 2));
+    std::vector<double> total((size_t)job.width * job.height * 3, 0.0);
+    std::vector<uint64_t> iterations(threads, 0), escaped(threads, 0);
+
+    // One independent chain per part of a round, persisting across rounds
+    std::vector<std::unique_ptr<MetropolisChain>> chains;
+    if(job.sampler == BuddhabrotJob::Metropolis)
+    {
+        for(unsigned part = 0; part < threads; part++)
+            chains.emplace_back(new MetropolisChain(view, job, maxIter, job.seed * 0xD1B54A32D192ED03ull + part));
+        pool.parallelFor((int)threads, [&](int part, unsigned worker)
+        {
+            chains[part]->start(iterations[worker]);
+        });
+    }
+
+    // Rounds are short enough for the per-thread float counters to stay exact and for
+    // snapshots to be timely, and long enough to make merging cheap
+    const uint64_t samples = (uint64_t)job.samples;
+    const uint64_t perRound = std::max<uint64_t>(threads, std::min<uint64_t>(samples, (uint64_t)threads << 16));
+    const uint64_t rounds = (samples + perRound - 1) / perRound;
+
+    std::cout << "[Buddhabrot]: " << job.width << "x" << job.height << ", limits " << job.limits[0] << "/"
+              << job.limits[1] << "/" << job.limits[2] << ", " << samples << " samples ("
+              << (job.sampler == BuddhabrotJob::Metropolis ? "Metropolis" : "uniform") << ") on " << threads
+              << " threads -> " << job.output << std::endl;
+
+    const int rowsPerChunk = 16;
+    const int chunks = (job.height + rowsPerChunk - 1) / rowsPerChunk;
+    const size_t chunkValues = (size_t)job.width * rowsPerChunk * 3;
+
+    Clock::time_point start = Clock::now(), lastSnapshot = start, lastReport = start;
+    uint64_t done = 0;
+    for(uint64_t round = 0; round < rounds; round++)
+    {
+        const uint64_t count = std::min(perRound, samples - done);
+        pool.parallelFor((int)threads, [&](int part, unsigned worker)
+        {
+            uint64_t first = count * part / threads, last = count * (part + 1) / threads;
+            float* counts = histograms[worker].data();
+            if(!chains.empty())
+            {
+                chains[part]->run(last - first, counts, iterations[worker]);
+                return;
+            }
+
+            Random random(job.seed * 0xD1B54A32D192ED03ull + round * threads + part);
+            double* orbit = orbits[worker].data();
+            for(uint64_t s = first; s < last; s++)
+            {
+                // Uniform over [-2, 2] x [0, 2]; the mirror orbit covers the lower half
+                double cx = random.uniform() * 4.0 - 2.0;
+                double cy = random.uniform() * 2.0;
+                int spent;
+                int length = TraceOrbit(cx, cy, maxIter, orbit, spent);
+                iterations[worker] += spent;
+                if(length < 0)
+                    continue;
+                escaped[worker]++;
+                if(length >= job.minIter)
+                    Splat(view, orbit, length, job.limits, 1.0f, counts);
+            }
+        });
+        done += count;
+
+        // Merge without atomics: each chunk of rows is summed over all threads by one job
+        pool.parallelFor(chunks, [&](int chunk, unsigned)
+        {
+            size_t begin = chunk * chunkValues, end = std::min(total.size(), begin + chunkValues);
+            for(std::vector<float>& h : histograms)
+            {
+                float* counts = h.data();
+                for(size_t i = begin; i < end; i++)
+                {
+                    total[i] += counts[i];
+                    counts[i] = 0.0f;
+                }
+            }
+        });
+
+        Clock::time_point now = Clock::now();
+        if(job.snapshotInterval > 0 && done < samples && now - lastSnapshot >= std::chrono::seconds(job.snapshotInterval))
+        {
+            WriteSnapshot(job, total, threads);
+            lastSnapshot = Clock::now();
+        }
+        if(done < samples && now - lastReport > std::chrono::seconds(1))
+        {
+            double elapsed = std::chrono::duration<double>(now - start).count();
+            double progress = (double)done / samples;
+            std::printf("\r[Buddhabrot]: %5.1f%%  %.2f Msamples/s  ETA %.0fs   ", progress * 100,
+                        done / elapsed * 1e-6, elapsed / progress - elapsed);
+            std::fflush(stdout);
+            lastReport = now;
+        }
+    }
+    WriteSnapshot(job, total, threads);
+
+    uint64_t totalIterations = 0, totalEscaped = 0;
+    for(unsigned t = 0; t < threads; t++)
+    {
+        totalIterations += iterations[t];
+        totalEscaped += escaped[t];
+    }
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    std::printf("\r[Buddhabrot]: done in %.2fs  %.2f Msamples/s  %.3f Giter/s", elapsed, samples / elapsed * 1e-6,
+                totalIterations / elapsed * 1e-9);
+    if(chains.empty())
+        std::printf("  %.1f%% of orbits escaped\n", 100.0 * totalEscaped / samples);
+    else
+    {
+        uint64_t accepted = 0, proposed = 0;
+        for(const std::unique_ptr<MetropolisChain>& chain : chains)
+        {
+            accepted += chain->accepted();
+            proposed += chain->proposed();
+        }
+        std::printf("  %.1f%% of mutations accepted\n", 100.0 * accepted / proposed);
+    }
+}
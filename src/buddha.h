@@ -0,0 +1,34 @@
+#ifndef MANDELBROTSET_BUDDHA_H
+#define MANDELBROTSET_BUDDHA_H
+
+#include <string>
+#include <cstdint>
+#include "fractal.h"
+
+// Buddhabrot: the density of the orbits of escaping points, drawn in the view
+// described by `params` (same mapping as fragment.glsl). Each color channel
+// counts only orbits escaping within its own iteration limit (Nebulabrot);
+// equal limits give a grayscale image.
+struct BuddhabrotJob
+{
+    // Uniform sampling of c wastes nearly every orbit on zoomed views; the
+    // Metropolis sampler concentrates on the orbits that cross the view
+    enum Sampler { Uniform, Metropolis };
+
+    Sampler sampler = Uniform;
+    FractalParams params;
+    int width = 1024, height = 1024;
+    int viewWidth = 800;
+    int limits[3] = { 5000, 500, 50 };  // red, green, blue
+    int minIter = 20;                   // shorter orbits are ignored, they only add a haze
+    double samples = 1e8;
+    uint64_t seed = 1;
+    double gamma = 0.5;
+    int snapshotInterval = 10;          // seconds between progressive snapshots, 0 = only at the end
+    unsigned threads = 0;
+    std::string output = "buddha.png";
+};
+
+void RenderBuddhabrot(const BuddhabrotJob& job);
+
+#endif //MANDELBROTSET_BUDDHA_H
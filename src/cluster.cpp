@@ -0,0 +1,443 @@
+#include "cluster.h"
+#include "socket.h"
+#include "palette.h"
+#include "threadpool.h"
+#include "imagewriter.h"
+#include "fileutil.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <signal.h>
+#include <unistd.h>
+#endif
+
+// Every message is a 4 character tag and a big-endian payload length, then the payload:
+//   HELO  worker -> coordinator  u32 threads
+//   JOB   coordinator -> worker  text "iter zoom OffX OffY width height"
+//   TILE  coordinator -> worker  u32 id, x0, y0, width, height
+//   DONE  worker -> coordinator  u32 id, then width*height little-endian u32 iteration counts
+//   BEAT  worker -> coordinator  heartbeat, sent every second
+//   QUIT  coordinator -> worker  the job is complete
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    const size_t HeaderSize = 8;
+    const int TilesInFlight = 2;    // per worker, hides the round trip between tiles
+
+    void PutU32(uint8_t* p, uint32_t v)
+    {
+        p[0] = uint8_t(v >> 24);
+        p[1] = uint8_t(v >> 16);
+        p[2] = uint8_t(v >> 8);
+        p[3] = uint8_t(v);
+    }
+
+    uint32_t GetU32(const uint8_t* p)
+    {
+        return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+    }
+
+    void SendMessage(Socket& socket, const char* tag, const void* payload, size_t size)
+    {
+        uint8_t header[HeaderSize];
+        std::copy(tag, tag + 4, header);
+        PutU32(header + 4, (uint32_t)size);
+        socket.sendAll(header, HeaderSize);
+        if(size)
+            socket.sendAll(payload, size);
+    }
+
+    void SendWords(Socket& socket, const char* tag, const std::vector<uint32_t>& words)
+    {
+        std::vector<uint8_t> payload(words.size() * 4);
+        for(size_t i = 0; i < words.size(); i++)
+            PutU32(&payload[i * 4], words[i]);
+        SendMessage(socket, tag, payload.data(), payload.size());
+    }
+
+    struct Tile
+    {
+        int x0, y0, w, h;
+    };
+
+    struct Worker
+    {
+        Socket socket;
+        std::vector<uint8_t> inbox;
+        std::deque<int> tiles;
+        Clock::time_point lastSeen;
+        bool ready = false;
+        unsigned threads = 0;
+        int completed = 0;
+        int id = 0;
+    };
+
+    void SpawnWorkers(const ClusterJob& job, int port, std::vector<long>& children)
+    {
+#ifdef _WIN32
+        throw std::runtime_error("[Cluster]: --spawn is not supported on Windows, start the workers manually");
+#else
+        std::string exe = FileExists("/proc/self/exe") ? "/proc/self/exe" : job.executable;
+        unsigned threads = job.workerThreads;
+        if(threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency() / job.spawn);
+        std::string address = "127.0.0.1:" + std::to_string(port);
+        std::string threadArg = std::to_string(threads);
+        for(int i = 0; i < job.spawn; i++)
+        {
+            pid_t pid = fork();
+            if(pid == 0)
+            {
+                execl(exe.c_str(), exe.c_str(), "worker", "--connect", address.c_str(), "--threads", threadArg.c_str(),
+                      (char*)nullptr);
+                _exit(127);
+            }
+            if(pid < 0)
+                throw std::runtime_error("[Cluster]: Could not start a worker process");
+            children.push_back(pid);
+        }
+#endif
+    }
+
+    // Spawned workers exit on QUIT; the ones that hung (and were dropped) are killed after a grace period
+    void WaitForChildren(const std::vector<long>& children)
+    {
+#ifndef _WIN32
+        Clock::time_point deadline = Clock::now() + std::chrono::seconds(2);
+        for(long pid : children)
+        {
+            while(waitpid((pid_t)pid, nullptr, WNOHANG) == 0)
+            {
+                if(Clock::now() > deadline)
+                {
+                    kill((pid_t)pid, SIGKILL);
+                    waitpid((pid_t)pid, nullptr, 0);
+                    break;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+        }
+#endif
+    }
+}
+
+void RunCoordinator(const ClusterJob& job)
+{
+    if(job.width <= 0 || job.height <= 0 || job.tileSize <= 0)
+        throw std::runtime_error("[Cluster]: Invalid job dimensions");
+
+    Palette palette(job.palette.c_str());
+    Socket listener = Socket::Listen(job.bind, job.port);
+    listener.setNonBlocking(true);
+    const int port = listener.port();
+
+    FractalParams params = job.params;
+    params.zoom *= (double)job.width / job.viewWidth;
+    std::ostringstream description;
+    description.precision(17);
+    description << params.iter << " " << params.zoom << " " << params.OffX << " " << params.OffY << " "
+                << job.width << " " << job.height;
+    const std::string jobText = description.str();
+
+    std::vector<Tile> tiles;
+    for(int y = 0; y < job.height; y += job.tileSize)
+        for(int x = 0; x < job.width; x += job.tileSize)
+        {
+            Tile t = { x, y, std::min(job.tileSize, job.width - x), std::min(job.tileSize, job.height - y) };
+            tiles.push_back(t);
+        }
+    std::deque<int> pending;
+    for(int i = 0; i < (int)tiles.size(); i++)
+        pending.push_back(i);
+    std::vector<bool> finished(tiles.size(), false);
+    int finishedCount = 0;
+
+    // Tile rows are written in order as soon as they are complete, so only the rows
+    // still open (or waiting for an earlier one) are held in memory
+    const int tileColumns = (job.width + job.tileSize - 1) / job.tileSize;
+    const int tileRows = (job.height + job.tileSize - 1) / job.tileSize;
+    std::map<int, std::vector<uint8_t>> openRows;
+    std::vector<int> rowTilesLeft(tileRows, tileColumns);
+    int nextRow = 0;
+    std::unique_ptr<ImageWriter> writer = CreateImageWriter(job.output, job.width, job.height, 0);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    int nextWorkerId = 0;
+
+    std::cout << "[Cluster]: coordinator listening on " << job.bind << ":" << port << ", "
+              << tiles.size() << " tiles" << std::endl;
+    std::vector<long> children;
+    if(job.spawn > 0)
+        SpawnWorkers(job, port, children);
+
+    auto dropWorker = [&](size_t index, const char* reason)
+    {
+        Worker& w = *workers[index];
+        std::cout << "\n[Cluster]: worker " << w.id << " " << reason << ", reassigning " << w.tiles.size()
+                  << " tiles" << std::endl;
+        for(auto it = w.tiles.rbegin(); it != w.tiles.rend(); ++it)
+            pending.push_front(*it);
+        workers.erase(workers.begin() + index);
+    };
+
+    // Returns false if the worker sent something invalid
+    auto handleMessage = [&](Worker& w, const char* tag, const uint8_t* payload, size_t size) -> bool
+    {
+        std::string t(tag, 4);
+        if(t == "HELO" && size >= 4)
+        {
+            w.threads = GetU32(payload);
+            w.ready = true;
+            SendMessage(w.socket, "JOB ", jobText.data(), jobText.size());
+        }
+        else if(t == "DONE" && size >= 4)
+        {
+            uint32_t id = GetU32(payload);
+            auto it = std::find(w.tiles.begin(), w.tiles.end(), (int)id);
+            if(it == w.tiles.end())
+                return false;
+            const Tile& tile = tiles[id];
+            if(size != 4 + (size_t)tile.w * tile.h * 4)
+                return false;
+            w.tiles.erase(it);
+            if(!finished[id])
+            {
+                std::vector<uint32_t> iters((size_t)tile.w * tile.h);
+                for(size_t i = 0; i < iters.size(); i++)
+                {
+                    const uint8_t* p = payload + 4 + i * 4;
+                    iters[i] = p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+                }
+                const int row = tile.y0 / job.tileSize;
+                std::vector<uint8_t>& rgb = openRows[row];
+                if(rgb.empty())
+                    rgb.resize((size_t)job.width * tile.h * 3);
+                for(int j = 0; j < tile.h; j++)
+                    palette.colorize(&iters[(size_t)j * tile.w], tile.w, params.iter, params.freq, params.UVoffset,
+                                     &rgb[((size_t)j * job.width + tile.x0) * 3]);
+                finished[id] = true;
+                finishedCount++;
+                w.completed++;
+
+                rowTilesLeft[row]--;
+                while(nextRow < tileRows && rowTilesLeft[nextRow] == 0)
+                {
+                    writer->writeRows(openRows[nextRow].data(), std::min(job.tileSize, job.height - nextRow * job.tileSize));
+                    openRows.erase(nextRow);
+                    nextRow++;
+                }
+            }
+        }
+        else if(t != "BEAT")
+            return false;
+        return true;
+    };
+
+    Clock::time_point start = Clock::now(), lastReport = start;
+    while(finishedCount < (int)tiles.size())
+    {
+        std::vector<Socket*> sockets(1, &listener);
+        for(auto& w : workers)
+            sockets.push_back(&w->socket);
+        std::unique_ptr<bool[]> readable(new bool[sockets.size()]);
+        Socket::Poll(sockets.data(), sockets.size(), 200, readable.get());
+        Clock::time_point now = Clock::now();
+
+        if(readable[0])
+        {
+            Socket s = listener.accept();
+            if(s.valid())
+            {
+                std::unique_ptr<Worker> w(new Worker);
+                s.setNonBlocking(true);
+                w->socket = std::move(s);
+                w->lastSeen = now;
+                w->id = nextWorkerId++;
+                workers.push_back(std::move(w));
+            }
+        }
+
+        for(size_t i = workers.size(); i-- > 0;)
+        {
+            Worker& w = *workers[i];
+            bool alive = true;
+            if(i + 1 < sockets.size() && readable[i + 1])
+            {
+                uint8_t buffer[65536];
+                long n;
+                while((n = w.socket.recvSome(buffer, sizeof(buffer))) > 0)
+                    w.inbox.insert(w.inbox.end(), buffer, buffer + n);
+                alive = n != 0;
+                w.lastSeen = now;
+
+                size_t offset = 0;
+                while(alive && w.inbox.size() - offset >= HeaderSize)
+                {
+                    size_t size = GetU32(&w.inbox[offset + 4]);
+                    if(w.inbox.size() - offset - HeaderSize < size)
+                        break;
+                    alive = handleMessage(w, (const char*)&w.inbox[offset], &w.inbox[offset + HeaderSize], size);
+                    offset += HeaderSize + size;
+                }
+                w.inbox.erase(w.inbox.begin(), w.inbox.begin() + offset);
+            }
+
+            if(!alive)
+                dropWorker(i, "disconnected");
+            else if(now - w.lastSeen > std::chrono::seconds(job.heartbeatTimeout))
+                dropWorker(i, "timed out");
+        }
+
+        for(auto& w : workers)
+        {
+            while(w->ready && (int)w->tiles.size() < TilesInFlight && !pending.empty())
+            {
+                int id = pending.front();
+                pending.pop_front();
+                if(finished[id])
+                    continue;
+                const Tile& t = tiles[id];
+                try
+                {
+                    SendWords(w->socket, "TILE", { (uint32_t)id, (uint32_t)t.x0, (uint32_t)t.y0,
+                                                   (uint32_t)t.w, (uint32_t)t.h });
+                }
+                catch(const std::runtime_error&)
+                {
+                    pending.push_front(id);
+                    break;  // the next poll reports the broken connection
+                }
+                w->tiles.push_back(id);
+            }
+        }
+
+        if(now - lastReport > std::chrono::seconds(1))
+        {
+            std::printf("\r[Cluster]: %d/%d tiles, %d workers   ", finishedCount, (int)tiles.size(), (int)workers.size());
+            std::fflush(stdout);
+            lastReport = now;
+        }
+    }
+
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    for(auto& w : workers)
+    {
+        try { SendMessage(w->socket, "QUIT", nullptr, 0); }
+        catch(const std::runtime_error&) {}
+        std::cout << "\n[Cluster]: worker " << w->id << " (" << w->threads << " threads) rendered "
+                  << w->completed << " tiles";
+    }
+    workers.clear();
+    WaitForChildren(children);
+
+    writer->finish();
+    std::printf("\n[Cluster]: rendered in %.2fs (%.2f Mpix/s) -> %s\n", elapsed,
+                (double)job.width * job.height / elapsed * 1e-6, job.output.c_str());
+}
+
+void RunWorker(const std::string& host, int port, unsigned threads)
+{
+    Socket socket = Socket::Connect(host, port);
+    ThreadPool pool(threads);
+    std::mutex sendMutex;
+
+    {
+        std::lock_guard<std::mutex> lock(sendMutex);
+        SendWords(socket, "HELO", { pool.size() });
+    }
+
+    bool stop = false;
+    std::mutex stopMutex;
+    std::condition_variable stopCv;
+    std::thread heartbeat([&]
+    {
+        std::unique_lock<std::mutex> lock(stopMutex);
+        while(!stopCv.wait_for(lock, std::chrono::seconds(1), [&]{ return stop; }))
+        {
+            try
+            {
+                std::lock_guard<std::mutex> sendLock(sendMutex);
+                SendMessage(socket, "BEAT", nullptr, 0);
+            }
+            catch(const std::runtime_error&)
+            {
+                return;
+            }
+        }
+    });
+
+    FractalParams params;
+    int width = 0, height = 0;
+    int tilesDone = 0;
+    try
+    {
+        uint8_t header[HeaderSize];
+        while(socket.recvAll(header, HeaderSize))
+        {
+            std::string tag((const char*)header, 4);
+            std::vector<uint8_t> payload(GetU32(header + 4));
+            if(!payload.empty() && !socket.recvAll(payload.data(), payload.size()))
+                break;
+
+            if(tag == "JOB ")
+            {
+                std::istringstream in(std::string(payload.begin(), payload.end()));
+                in >> params.iter >> params.zoom >> params.OffX >> params.OffY >> width >> height;
+            }
+            else if(tag == "TILE" && payload.size() == 20 && width > 0)
+            {
+                uint32_t id = GetU32(&payload[0]);
+                int x0 = (int)GetU32(&payload[4]), y0 = (int)GetU32(&payload[8]);
+                int w = (int)GetU32(&payload[12]), h = (int)GetU32(&payload[16]);
+
+                std::vector<uint32_t> iters((size_t)w * h);
+                pool.parallelFor(h, [&](int row, unsigned)
+                {
+                    Fractal::RenderIterations(params, width, height, x0, y0 + row, w, 1, &iters[(size_t)row * w], w);
+                });
+
+                std::vector<uint8_t> result(4 + iters.size() * 4);
+                PutU32(&result[0], id);
+                for(size_t i = 0; i < iters.size(); i++)
+                {
+                    uint8_t* p = &result[4 + i * 4];
+                    p[0] = uint8_t(iters[i]);
+                    p[1] = uint8_t(iters[i] >> 8);
+                    p[2] = uint8_t(iters[i] >> 16);
+                    p[3] = uint8_t(iters[i] >> 24);
+                }
+                std::lock_guard<std::mutex> lock(sendMutex);
+                SendMessage(socket, "DONE", result.data(), result.size());
+                tilesDone++;
+            }
+            else if(tag == "QUIT")
+                break;
+        }
+    }
+    catch(const std::runtime_error& e)
+    {
+        std::cerr << "[Worker]: " << e.what() << std::endl;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(stopMutex);
+        stop = true;
+    }
+    stopCv.notify_all();
+    heartbeat.join();
+    std::cout << "[Worker]: rendered " << tilesDone << " tiles" << std::endl;
+}
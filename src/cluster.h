@@ -0,0 +1,32 @@
+#ifndef MANDELBROTSET_CLUSTER_H
+#define MANDELBROTSET_CLUSTER_H
+
+#include <string>
+#include "fractal.h"
+
+// A poster rendered by worker processes connected over TCP. The coordinator
+// splits the image into tiles, hands them out, reassigns the tiles of workers
+// that disconnect or stop sending heartbeats, and streams the finished rows of
+// tiles to the output.
+struct ClusterJob
+{
+    FractalParams params;
+    int width = 8000, height = 8000;
+    int viewWidth = 800;
+    int tileSize = 256;
+    std::string bind = "127.0.0.1";
+    int port = 0;               // 0 = any free port
+    int spawn = 0;              // worker processes to start on this machine
+    unsigned workerThreads = 0; // threads per spawned worker, 0 = share the cores evenly
+    int heartbeatTimeout = 5;   // seconds of silence before a worker is considered dead
+    std::string executable;     // used to start the spawned workers
+    std::string palette = "img/pal.png";
+    std::string output = "cluster.png";
+};
+
+void RunCoordinator(const ClusterJob& job);
+
+// Connects to a coordinator and renders tiles until told to quit
+void RunWorker(const std::string& host, int port, unsigned threads);
+
+#endif //MANDELBROTSET_CLUSTER_H
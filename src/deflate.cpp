@@ -0,0 +1,427 @@
+#include "deflate.h"
+#include <algorithm>
+#include <queue>
+
+namespace
+{
+    const int WindowSize = 32768;
+    const int WindowMask = WindowSize - 1;
+    const int HashBits = 15;
+    const int MinMatch = 3;
+    const int MaxMatch = 258;
+    const int MaxChain = 48;
+    const size_t BlockSymbols = 1 << 16;
+
+    const uint16_t LengthBase[29] = {3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258};
+    const uint8_t LengthExtra[29] = {0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0};
+    const uint16_t DistBase[30] = {1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,1025,1537,2049,3073,
+                                   4097,6145,8193,12289,16385,24577};
+    const uint8_t DistExtra[30] = {0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13};
+    const uint8_t CodeLengthOrder[19] = {16,17,18,0,8,7,9,6,10,5,11,4,12,3,13,2,14,1,15};
+
+    // A literal (dist == 0) or a back reference
+    struct Symbol
+    {
+        uint16_t value;
+        uint16_t dist;
+    };
+
+    class BitWriter
+    {
+    public:
+        explicit BitWriter(std::vector<uint8_t>& out) : m_out(out) {}
+
+        void put(uint32_t bits, int count)
+        {
+            m_buffer |= (uint64_t)bits << m_count;
+            m_count += count;
+            while(m_count >= 8)
+            {
+                m_out.push_back((uint8_t)m_buffer);
+                m_buffer >>= 8;
+                m_count -= 8;
+            }
+        }
+
+        void align()
+        {
+            if(m_count > 0)
+                put(0, 8 - m_count);
+        }
+
+    private:
+        std::vector<uint8_t>& m_out;
+        uint64_t m_buffer = 0;
+        int m_count = 0;
+    };
+
+    int LengthCode(int length)
+    {
+        return int(std::upper_bound(LengthBase, LengthBase + 29, length) - LengthBase) - 1;
+    }
+
+    int DistCode(int dist)
+    {
+        return int(std::upper_bound(DistBase, DistBase + 30, dist) - DistBase) - 1;
+    }
+
+    // Huffman code lengths no longer than `limit`; frequencies are flattened until they fit
+    void BuildLengths(const uint32_t* freq, int n, int limit, uint8_t* lengths)
+    {
+        std::vector<uint32_t> f(freq, freq + n);
+        while(true)
+        {
+            std::fill(lengths, lengths + n, 0);
+            std::vector<int> parent;
+            std::vector<int> leaf(n, -1);
+            typedef std::pair<uint64_t, int> Item;
+            std::priority_queue<Item, std::vector<Item>, std::greater<Item>> heap;
+            for(int i = 0; i < n; i++)
+            {
+                if(f[i] == 0)
+                    continue;
+                leaf[i] = (int)parent.size();
+                heap.push(Item(f[i], (int)parent.size()));
+                parent.push_back(-1);
+            }
+            if(heap.size() == 1)
+            {
+                for(int i = 0; i < n; i++)
+                    if(leaf[i] >= 0)
+                        lengths[i] = 1;
+                return;
+            }
+            while(heap.size() > 1)
+            {
+                Item a = heap.top(); heap.pop();
+                Item b = heap.top(); heap.pop();
+                int node = (int)parent.size();
+                parent.push_back(-1);
+                parent[a.second] = node;
+                parent[b.second] = node;
+                heap.push(Item(a.first + b.first, node));
+            }
+
+            // parents are always created after their children
+            std::vector<int> depth(parent.size(), 0);
+            for(int i = (int)parent.size() - 2; i >= 0; i--)
+                depth[i] = depth[parent[i]] + 1;
+
+            int maxDepth = 0;
+            for(int i = 0; i < n; i++)
+                if(leaf[i] >= 0)
+                {
+                    lengths[i] = (uint8_t)depth[leaf[i]];
+                    maxDepth = std::max(maxDepth, depth[leaf[i]]);
+                }
+            if(maxDepth <= limit)
+                return;
+
+            for(int i = 0; i < n; i++)
+                if(f[i])
+                    f[i] = (f[i] >> 1) | 1;
+        }
+    }
+
+    // Canonical codes, bit-reversed for LSB-first output
+    void BuildCodes(const uint8_t* lengths, int n, uint16_t* codes)
+    {
+        int count[16] = {0};
+        int next[16] = {0};
+        for(int i = 0; i < n; i++)
+            count[lengths[i]]++;
+        count[0] = 0;
+        int code = 0;
+        for(int bits = 1; bits < 16; bits++)
+        {
+            code = (code + count[bits - 1]) << 1;
+            next[bits] = code;
+        }
+        for(int i = 0; i < n; i++)
+        {
+            int len = lengths[i];
+            if(!len)
+                continue;
+            int c = next[len]++, r = 0;
+            for(int b = 0; b < len; b++)
+                r |= ((c >> b) & 1) << (len - 1 - b);
+            codes[i] = (uint16_t)r;
+        }
+    }
+
+    // Decoders reject trees with fewer than two codes, so pad with dummy symbols
+    void EnsureTwoCodes(uint32_t* freq, int n)
+    {
+        int used = 0;
+        for(int i = 0; i < n; i++)
+            used += freq[i] != 0;
+        for(int i = 0; i < n && used < 2; i++)
+            if(!freq[i])
+            {
+                freq[i] = 1;
+                used++;
+            }
+    }
+
+    void WriteBlock(BitWriter& bw, const std::vector<Symbol>& symbols, bool final)
+    {
+        uint32_t litFreq[286] = {0}, distFreq[30] = {0};
+        for(const Symbol& s : symbols)
+        {
+            if(s.dist == 0)
+                litFreq[s.value]++;
+            else
+            {
+                litFreq[257 + LengthCode(s.value)]++;
+                distFreq[DistCode(s.dist)]++;
+            }
+        }
+        litFreq[256] = 1;
+        EnsureTwoCodes(litFreq, 286);
+        EnsureTwoCodes(distFreq, 30);
+
+        uint8_t litLen[286], distLen[30];
+        uint16_t litCode[286], distCode[30];
+        BuildLengths(litFreq, 286, 15, litLen);
+        BuildLengths(distFreq, 30, 15, distLen);
+        BuildCodes(litLen, 286, litCode);
+        BuildCodes(distLen, 30, distCode);
+
+        int hlit = 286, hdist = 30;
+        while(hlit > 257 && litLen[hlit - 1] == 0) hlit--;
+        while(hdist > 1 && distLen[hdist - 1] == 0) hdist--;
+
+        // Run-length encode both code length tables as one sequence
+        std::vector<uint8_t> all(litLen, litLen + hlit);
+        all.insert(all.end(), distLen, distLen + hdist);
+        std::vector<std::pair<uint8_t, uint8_t>> rle; // (symbol, extra bits value)
+        for(size_t i = 0; i < all.size();)
+        {
+            uint8_t v = all[i];
+            size_t run = 1;
+            while(i + run < all.size() && all[i + run] == v)
+                run++;
+
+            if(v == 0 && run >= 3)
+            {
+                size_t r = std::min<size_t>(run, 138);
+                if(r >= 11) rle.push_back(std::make_pair(18, (uint8_t)(r - 11)));
+                else rle.push_back(std::make_pair(17, (uint8_t)(r - 3)));
+                i += r;
+            }
+            else if(v != 0 && run >= 4)
+            {
+                size_t r = std::min<size_t>(run - 1, 6);
+                rle.push_back(std::make_pair(v, 0));
+                rle.push_back(std::make_pair(16, (uint8_t)(r - 3)));
+                i += r + 1;
+            }
+            else
+            {
+                rle.push_back(std::make_pair(v, 0));
+                i++;
+            }
+        }
+
+        uint32_t clFreq[19] = {0};
+        for(auto& r : rle)
+            clFreq[r.first]++;
+        EnsureTwoCodes(clFreq, 19);
+        uint8_t clLen[19];
+        uint16_t clCode[19];
+        BuildLengths(clFreq, 19, 7, clLen);
+        BuildCodes(clLen, 19, clCode);
+        int hclen = 19;
+        while(hclen > 4 && clLen[CodeLengthOrder[hclen - 1]] == 0) hclen--;
+
+        bw.put(final ? 1 : 0, 1);
+        bw.put(2, 2);
+        bw.put(hlit - 257, 5);
+        bw.put(hdist - 1, 5);
+        bw.put(hclen - 4, 4);
+        for(int i = 0; i < hclen; i++)
+            bw.put(clLen[CodeLengthOrder[i]], 3);
+        for(auto& r : rle)
+        {
+            bw.put(clCode[r.first], clLen[r.first]);
+            if(r.first == 16) bw.put(r.second, 2);
+            else if(r.first == 17) bw.put(r.second, 3);
+            else if(r.first == 18) bw.put(r.second, 7);
+        }
+
+        for(const Symbol& s : symbols)
+        {
+            if(s.dist == 0)
+            {
+                bw.put(litCode[s.value], litLen[s.value]);
+                continue;
+            }
+            int lc = LengthCode(s.value);
+            bw.put(litCode[257 + lc], litLen[257 + lc]);
+            bw.put(s.value - LengthBase[lc], LengthExtra[lc]);
+            int dc = DistCode(s.dist);
+            bw.put(distCode[dc], distLen[dc]);
+            bw.put(s.dist - DistBase[dc], DistExtra[dc]);
+        }
+        bw.put(litCode[256], litLen[256]);
+    }
+
+    uint32_t Hash(const uint8_t* p)
+    {
+        uint32_t v = p[0] | (p[1] << 8) | (p[2] << 16);
+        return (v * 2654435761u) >> (32 - HashBits);
+    }
+}
+
+void Deflate::Compress(const uint8_t* data, size_t size, bool last, std::vector<uint8_t>& out)
+{
+    BitWriter bw(out);
+    std::vector<int64_t> head((size_t)1 << HashBits, -1);
+    std::vector<int64_t> prev(WindowSize, -1);
+    std::vector<Symbol> symbols;
+    symbols.reserve(BlockSymbols);
+
+    auto insert = [&](size_t pos)
+    {
+        if(pos + MinMatch > size)
+            return;
+        uint32_t h = Hash(data + pos);
+        prev[pos & WindowMask] = head[h];
+        head[h] = (int64_t)pos;
+    };
+
+    size_t pos = 0;
+    while(pos < size)
+    {
+        int bestLen = 0, bestDist = 0;
+        if(pos + MinMatch <= size)
+        {
+            const int maxLen = (int)std::min<size_t>(MaxMatch, size - pos);
+            int64_t cand = head[Hash(data + pos)];
+            for(int chain = MaxChain; cand >= 0 && (int64_t)pos - cand <= WindowSize && chain > 0; chain--)
+            {
+                const uint8_t* a = data + cand;
+                const uint8_t* b = data + pos;
+                if(a[bestLen] == b[bestLen])
+                {
+                    int len = 0;
+                    while(len < maxLen && a[len] == b[len])
+                        len++;
+                    if(len > bestLen)
+                    {
+                        bestLen = len;
+                        bestDist = int(pos - cand);
+                        if(len == maxLen)
+                            break;
+                    }
+                }
+                int64_t next = prev[cand & WindowMask];
+                if(next >= cand)
+                    break;
+                cand = next;
+            }
+        }
+
+        Symbol s;
+        if(bestLen >= MinMatch)
+        {
+            s.value = (uint16_t)bestLen;
+            s.dist = (uint16_t)bestDist;
+            for(int i = 0; i < bestLen; i++)
+                insert(pos + i);
+            pos += bestLen;
+        }
+        else
+        {
+            s.value = data[pos];
+            s.dist = 0;
+            insert(pos);
+            pos++;
+        }
+        symbols.push_back(s);
+
+        if(symbols.size() >= BlockSymbols)
+        {
+            WriteBlock(bw, symbols, last && pos == size);
+            symbols.clear();
+        }
+    }
+
+    if(!symbols.empty() || (last && size == 0))
+        WriteBlock(bw, symbols, last);
+
+    if(!last)
+    {
+        // empty stored block
+        bw.put(0, 3);
+        bw.align();
+        bw.put(0x0000, 16);
+        bw.put(0xFFFF, 16);
+    }
+    bw.align();
+}
+
+void Deflate::FinalBlock(std::vector<uint8_t>& out)
+{
+    // fixed Huffman block holding only the end-of-block code
+    out.push_back(0x03);
+    out.push_back(0x00);
+}
+
+uint32_t Deflate::Adler32(uint32_t adler, const uint8_t* data, size_t size)
+{
+    const uint32_t Base = 65521;
+    uint32_t a = adler & 0xFFFF, b = adler >> 16;
+    while(size > 0)
+    {
+        size_t n = std::min<size_t>(size, 5552);
+        size -= n;
+        while(n--)
+        {
+            a += *data++;
+            b += a;
+        }
+        a %= Base;
+        b %= Base;
+    }
+    return a | (b << 16);
+}
+
+uint32_t Deflate::Adler32Combine(uint32_t adler1, uint32_t adler2, size_t size2)
+{
+    const uint32_t Base = 65521;
+    uint32_t rem = (uint32_t)(size2 % Base);
+    uint32_t sum1 = adler1 & 0xFFFF;
+    uint32_t sum2 = (uint32_t)(((uint64_t)rem * sum1) % Base);
+    sum1 += (adler2 & 0xFFFF) + Base - 1;
+    sum2 += ((adler1 >> 16) & 0xFFFF) + ((adler2 >> 16) & 0xFFFF) + Base - rem;
+    if(sum1 >= Base) sum1 -= Base;
+    if(sum1 >= Base) sum1 -= Base;
+    if(sum2 >= (Base << 1)) sum2 -= (Base << 1);
+    if(sum2 >= Base) sum2 -= Base;
+    return sum1 | (sum2 << 16);
+}
+
+uint32_t Deflate::Crc32(uint32_t crc, const uint8_t* data, size_t size)
+{
+    struct Table
+    {
+        uint32_t v[256];
+        Table()
+        {
+            for(uint32_t i = 0; i < 256; i++)
+            {
+                uint32_t c = i;
+                for(int k = 0; k < 8; k++)
+                    c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                v[i] = c;
+            }
+        }
+    };
+    static const Table table;
+
+    crc = ~crc;
+    for(size_t i = 0; i < size; i++)
+        crc = table.v[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
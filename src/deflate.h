@@ -0,0 +1,27 @@
+#ifndef MANDELBROTSET_DEFLATE_H
+#define MANDELBROTSET_DEFLATE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Small in-tree deflate (RFC 1951) encoder used by the image writers.
+// Every call produces an independent sequence of blocks, so buffers compressed
+// on different threads can simply be concatenated into one stream.
+namespace Deflate
+{
+    // Appends the compressed data to `out`. Unless `last` is set the output ends
+    // with an empty stored block (sync flush), leaving the stream byte aligned
+    // and open for the next part.
+    void Compress(const uint8_t* data, size_t size, bool last, std::vector<uint8_t>& out);
+
+    // A final empty block closing a stream made of non-final parts
+    void FinalBlock(std::vector<uint8_t>& out);
+
+    uint32_t Adler32(uint32_t adler, const uint8_t* data, size_t size);
+    // Adler-32 of the concatenation of two buffers, the second one `size2` bytes long
+    uint32_t Adler32Combine(uint32_t adler1, uint32_t adler2, size_t size2);
+    uint32_t Crc32(uint32_t crc, const uint8_t* data, size_t size);
+}
+
+#endif //MANDELBROTSET_DEFLATE_H
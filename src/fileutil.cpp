@@ -0,0 +1,97 @@
+#include "fileutil.h"
+#include <stdexcept>
+#include <cstdio>
+#include <cerrno>
+#include <sys/stat.h>
+#include <stb_image.h>
+#ifdef _WIN32
+#include <direct.h>
+#include <io.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+bool FileExists(const std::string& path)
+{
+    struct stat st;
+    return stat(path.c_str(), &st) == 0;
+}
+
+void MakeDirectories(const std::string& path)
+{
+    for(size_t i = 1; i <= path.size(); i++)
+    {
+        if(i != path.size() && path[i] != '/' && path[i] != '\\')
+            continue;
+        std::string dir = path.substr(0, i);
+#ifdef _WIN32
+        int err = _mkdir(dir.c_str());
+#else
+        int err = mkdir(dir.c_str(), 0755);
+#endif
+        if(err != 0 && errno != EEXIST)
+            throw std::runtime_error("[File]: Could not create directory " + dir);
+    }
+}
+
+void SyncFile(FILE* file)
+{
+    bool ok = std::fflush(file) == 0;
+#ifdef _WIN32
+    ok = ok && _commit(_fileno(file)) == 0;
+#else
+    ok = ok && fsync(fileno(file)) == 0;
+#endif
+    if(!ok)
+        throw std::runtime_error("[File]: Could not flush file to disk");
+}
+
+uint64_t FilePosition(FILE* file)
+{
+#ifdef _WIN32
+    return (uint64_t)_ftelli64(file);
+#else
+    return (uint64_t)ftello(file);
+#endif
+}
+
+FILE* ReopenTruncated(const std::string& path, uint64_t size)
+{
+    FILE* file = std::fopen(path.c_str(), "r+b");
+    if(!file)
+        return nullptr;
+#ifdef _WIN32
+    bool ok = _chsize_s(_fileno(file), (long long)size) == 0 && _fseeki64(file, 0, SEEK_END) == 0;
+#else
+    bool ok = ftruncate(fileno(file), (off_t)size) == 0 && fseeko(file, 0, SEEK_END) == 0;
+#endif
+    if(!ok || FilePosition(file) != size)
+    {
+        std::fclose(file);
+        return nullptr;
+    }
+    return file;
+}
+
+void RenameFile(const std::string& from, const std::string& to)
+{
+#ifdef _WIN32
+    bool ok = MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    bool ok = std::rename(from.c_str(), to.c_str()) == 0;
+#endif
+    if(!ok)
+        throw std::runtime_error("[File]: Could not rename " + from + " to " + to);
+}
+
+bool LoadImageRGB(const std::string& path, int& width, int& height, std::vector<uint8_t>& rgb)
+{
+    int bpp;
+    unsigned char* data = stbi_load(path.c_str(), &width, &height, &bpp, 3);
+    if(!data)
+        return false;
+    rgb.assign(data, data + (size_t)width * height * 3);
+    stbi_image_free(data);
+    return true;
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstdio>
+
+bool FileExists(const std::string& path);
+
+// Creates a directory and all missing parents
+void MakeDirectories(const std::string& path);
+
+// Flushes a stream all the way to the disk
+void SyncFile(FILE* file);
+
+uint64_t FilePosition(FILE* file);
+
+// Cuts an existing file to `size` bytes and opens it for writing at its end
+FILE* ReopenTruncated(const std::string& path, uint64_t size);
+
+// Atomically replaces `to` with `from`
+void RenameFile(const std::string& from, const std::string& to);
+
+// Loads an image file as packed 8-bit RGB
+bool LoadImageRGB(const std::string& path, int& width, int& height, std::vector<uint8_t>& rgb);
@@ -0,0 +1,154 @@
+#include "fractal.h"
+#include <cstddef>
+#include <algorithm>
+
+int Fractal::IterationsNumber(double cx, double cy, int iter)
+{
+    int n = 0;
+    double x = 0, y = 0;
+    for(int i = 1; i <= iter; i++)
+    {
+        double zx = x*x - y*y + cx;
+        double zy = 2.0 * x * y + cy;
+        if(zx*zx + zy*zy > 4.0)
+            break;
+        x = zx;
+        y = zy;
+        n++;
+    }
+    return n;
+}
+
+bool Fractal::InSet(double cx, double cy, int iter, int& spent)
+{
+    spent = 0;
+    double qx = cx - 0.25;
+    double q = qx*qx + cy*cy;
+    if(q * (q + qx) <= 0.25 * cy*cy)
+        return true;
+    if((cx + 1.0)*(cx + 1.0) + cy*cy <= 0.0625)
+        return true;
+
+    // Brent: compare against a checkpoint that moves to the current z every power of two steps
+    const double Epsilon = 1e-24;
+    double x = 0, y = 0, checkX = 0, checkY = 0;
+    int power = 1, steps = 0;
+    for(int i = 1; i <= iter; i++)
+    {
+        double zx = x*x - y*y + cx;
+        double zy = 2.0 * x * y + cy;
+        spent = i;
+        if(zx*zx + zy*zy > 4.0)
+            return false;
+        x = zx;
+        y = zy;
+
+        double dx = x - checkX, dy = y - checkY;
+        if(dx*dx + dy*dy < Epsilon)
+            return true;
+        if(++steps == power)
+        {
+            checkX = x;
+            checkY = y;
+            power *= 2;
+            steps = 0;
+        }
+    }
+    return true;
+}
+
+void Fractal::PixelToComplex(const FractalParams& params, int width, int height,
+                             double px, double py, double& cx, double& cy)
+{
+    // gl_FragCoord points at the pixel center and grows upwards
+    double fx = px + 0.5;
+    double fy = (height - py) - 0.5;
+    cx = (fx - width/2.0) / params.zoom - params.OffX;
+    cy = (fy - height/2.0) / params.zoom - params.OffY;
+}
+
+uint64_t Fractal::RenderIterations(const FractalParams& params, int width, int height,
+                                   int x0, int y0, int w, int h, uint32_t* out, int stride)
+{
+    uint64_t total = 0;
+    for(int j = 0; j < h; j++)
+    {
+        uint32_t* row = out + (size_t)j * stride;
+        for(int i = 0; i < w; i++)
+        {
+            double cx, cy;
+            PixelToComplex(params, width, height, x0 + i, y0 + j, cx, cy);
+            int n = IterationsNumber(cx, cy, params.iter);
+            row[i] = (uint32_t)n;
+            total += n;
+        }
+    }
+    return total;
+}
+
+uint64_t Fractal::RenderIterationsBatched(const FractalParams& params, int width, int height,
+                                          int x0, int y0, int w, int h, uint32_t* out, int stride)
+{
+    const int Lanes = 8;
+    uint64_t total = 0;
+    for(int j = 0; j < h; j++)
+    {
+        uint32_t* row = out + (size_t)j * stride;
+        for(int i0 = 0; i0 < w; i0 += Lanes)
+        {
+            const int lanes = std::min(Lanes, w - i0);
+            double cx[Lanes], cy[Lanes], x[Lanes], y[Lanes];
+            int n[Lanes], active[Lanes];
+            for(int l = 0; l < Lanes; l++)
+            {
+                // Lanes past the end of the row repeat the last pixel and are not stored
+                PixelToComplex(params, width, height, x0 + i0 + std::min(l, lanes - 1), y0 + j, cx[l], cy[l]);
+                x[l] = y[l] = 0;
+                n[l] = 0;
+                active[l] = 1;
+            }
+
+            for(int i = 1; i <= params.iter; i++)
+            {
+                int any = 0;
+                for(int l = 0; l < Lanes; l++)
+                {
+                    double zx = x[l]*x[l] - y[l]*y[l] + cx[l];
+                    double zy = 2.0 * x[l] * y[l] + cy[l];
+                    // Written as !(> 4) so that NaN orbits continue like in the scalar kernel
+                    int alive = active[l] & !(zx*zx + zy*zy > 4.0);
+                    x[l] = alive ? zx : x[l];
+                    y[l] = alive ? zy : y[l];
+                    n[l] += alive;
+                    active[l] = alive;
+                    any |= alive;
+                }
+                if(!any)
+                    break;
+            }
+
+            for(int l = 0; l < lanes; l++)
+            {
+                row[i0 + l] = (uint32_t)n[l];
+                total += n[l];
+            }
+        }
+    }
+    return total;
+}
+
+const Fractal::KernelInfo Fractal::Kernels[] =
+{
+    { "scalar", &Fractal::RenderIterations },
+    { "batched", &Fractal::RenderIterationsBatched },
+};
+
+const int Fractal::KernelCount = sizeof(Fractal::Kernels) / sizeof(Fractal::Kernels[0]);
+
+const Fractal::KernelInfo* Fractal::FindKernel(const std::string& name)
+{
+    for(int k = 0; k < KernelCount; k++)
+        if(name == Kernels[k].name)
+            return &Kernels[k];
+    return nullptr;
+}
@@ -0,0 +1,64 @@
+#ifndef MANDELBROTSET_FRACTAL_H
+#define MANDELBROTSET_FRACTAL_H
+
+#include <cstdint>
+#include <string>
+
+// View parameters shared by the window and the headless renderers.
+// The meaning of every field matches the uniforms of fragment.glsl.
+struct FractalParams
+{
+    int iter = 200;
+    double zoom = 100;
+    float freq = 30;
+    float UVoffset = 0.0;
+    double OffX = 0, OffY = 0;
+};
+
+namespace Fractal
+{
+    // CPU port of IterationsNumber() from fragment.glsl
+    int IterationsNumber(double cx, double cy, int iter);
+
+    // Membership test for numerical work. Points in the main cardioid and the period-2 bulb
+    // are accepted without iterating, and orbits that fall into a cycle (Brent's algorithm)
+    // stop early. Points that do not escape within `iter` iterations count as inside.
+    // `spent` receives the number of iterations performed.
+    bool InSet(double cx, double cy, int iter, int& spent);
+
+    // Maps a pixel of a width x height image (row 0 at the top) to the complex plane,
+    // exactly like the shader maps gl_FragCoord
+    void PixelToComplex(const FractalParams& params, int width, int height,
+                        double px, double py, double& cx, double& cy);
+
+    // Computes iteration counts for the rectangle [x0, x0+w) x [y0, y0+h) of a
+    // width x height image. Returns the total number of iterations spent.
+    uint64_t RenderIterations(const FractalParams& params, int width, int height,
+                              int x0, int y0, int w, int h, uint32_t* out, int stride);
+
+    // Same results as RenderIterations. Neighbouring pixels of a row are iterated in
+    // lockstep, a batch at a time, with escaped pixels masked out, so that the compiler
+    // can keep the batch in vector registers.
+    uint64_t RenderIterationsBatched(const FractalParams& params, int width, int height,
+                                     int x0, int y0, int w, int h, uint32_t* out, int stride);
+
+    typedef uint64_t (*Kernel)(const FractalParams& params, int width, int height,
+                               int x0, int y0, int w, int h, uint32_t* out, int stride);
+
+    struct KernelInfo
+    {
+        const char* name;
+        Kernel render;
+    };
+
+    // Every CPU kernel; they produce identical iteration counts and the first is the reference
+    extern const KernelInfo Kernels[];
+    extern const int KernelCount;
+    // Bump when a kernel is added, removed or changes its speed, so that tuning files are measured again
+    const int KernelTableVersion = 1;
+
+    // nullptr for an unknown name
+    const KernelInfo* FindKernel(const std::string& name);
+}
+
+#endif //MANDELBROTSET_FRACTAL_H
@@ -0,0 +1,227 @@
+#include "golden.h"
+#include "bench.h"
+#include "fractal.h"
+#include "threadpool.h"
+#include "deflate.h"
+#include "fileutil.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+    const char* GoldenMagic = "MandelbrotSet golden 1";
+
+    struct GoldenBuffer
+    {
+        int width = 0, height = 0, iter = 0;
+        std::vector<uint32_t> iters;
+    };
+
+    // Header line, then the counts as little endian 32-bit words
+    void SaveBuffer(const std::string& path, const GoldenBuffer& buffer)
+    {
+        std::vector<uint8_t> bytes(buffer.iters.size() * 4);
+        for(size_t i = 0; i < buffer.iters.size(); i++)
+            for(int b = 0; b < 4; b++)
+                bytes[i * 4 + b] = (uint8_t)(buffer.iters[i] >> (8 * b));
+
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out << GoldenMagic << "\n" << buffer.width << " " << buffer.height << " " << buffer.iter << " "
+            << Deflate::Crc32(0, bytes.data(), bytes.size()) << "\n";
+        out.write((const char*)bytes.data(), (std::streamsize)bytes.size());
+        if(!out)
+            throw std::runtime_error("[Golden]: Could not write " + path);
+    }
+
+    bool LoadBuffer(const std::string& path, GoldenBuffer& buffer)
+    {
+        std::ifstream in(path, std::ios::binary);
+        std::string magic;
+        uint32_t crc = 0;
+        if(!std::getline(in, magic))
+            return false;
+        if(magic != GoldenMagic || !(in >> buffer.width >> buffer.height >> buffer.iter >> crc))
+            throw std::runtime_error("[Golden]: " + path + " is not a golden buffer");
+        in.get();
+
+        std::vector<uint8_t> bytes((size_t)buffer.width * buffer.height * 4);
+        in.read((char*)bytes.data(), (std::streamsize)bytes.size());
+        if(!in || Deflate::Crc32(0, bytes.data(), bytes.size()) != crc)
+            throw std::runtime_error("[Golden]: " + path + " is damaged");
+        buffer.iters.resize((size_t)buffer.width * buffer.height);
+        for(size_t i = 0; i < buffer.iters.size(); i++)
+            buffer.iters[i] = bytes[i * 4] | bytes[i * 4 + 1] << 8 | bytes[i * 4 + 2] << 16 | (uint32_t)bytes[i * 4 + 3] << 24;
+        return true;
+    }
+
+    // "kernel view seconds" lines
+    std::map<std::string, double> LoadBudgets(const std::string& path)
+    {
+        std::map<std::string, double> budgets;
+        std::ifstream in(path);
+        std::string kernel, view;
+        double seconds;
+        while(in >> kernel >> view >> seconds)
+            budgets[kernel + " " + view] = seconds;
+        return budgets;
+    }
+
+    void SaveBudgets(const std::string& path, const std::map<std::string, double>& budgets)
+    {
+        std::ofstream out(path, std::ios::trunc);
+        for(const auto& b : budgets)
+            out << b.first << " " << b.second << "\n";
+        if(!out)
+            throw std::runtime_error("[Golden]: Could not write " + path);
+    }
+
+    // Median time of `repeat` renders in 8-row strips; unlike the best time it does not
+    // drift down over repeated checks, and unlike the mean one slow run does not move it
+    double Render(const Fractal::KernelInfo& kernel, const FractalParams& params, int width, int height,
+                  ThreadPool& pool, int repeat, std::vector<uint32_t>& iters)
+    {
+        const int StripRows = 8;
+        iters.assign((size_t)width * height, 0);
+        std::vector<double> times;
+        for(int r = 0; r < repeat; r++)
+        {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            pool.parallelFor((height + StripRows - 1) / StripRows, [&](int s, unsigned)
+            {
+                const int y0 = s * StripRows;
+                kernel.render(params, width, height, 0, y0, width, std::min(StripRows, height - y0),
+                              iters.data() + (size_t)y0 * width, width);
+            });
+            times.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        }
+        std::sort(times.begin(), times.end());
+        return times[times.size() / 2];
+    }
+
+    template<typename T>
+    bool Selected(const std::vector<std::string>& names, const T& item)
+    {
+        return names.empty() || std::find(names.begin(), names.end(), item.name) != names.end();
+    }
+}
+
+int RunGolden(const GoldenJob& job)
+{
+    if(job.width <= 0 || job.height <= 0 || job.repeat <= 0)
+        throw std::runtime_error("[Golden]: Invalid job");
+    MakeDirectories(job.dir);
+
+    ThreadPool pool(job.threads);
+    const std::string budgetPath = job.budgets;
+    std::map<std::string, double> budgets = LoadBudgets(budgetPath);
+    bool budgetsChanged = false;
+    int failures = 0, checks = 0;
+
+    std::printf("[Golden]: %dx%d on %u threads, %s %s\n", job.width, job.height, pool.size(),
+                job.update ? "updating" : "checking", job.dir.c_str());
+    for(const CanonicalView& view : CanonicalViews())
+    {
+        if(!Selected(job.views, view))
+            continue;
+        FractalParams params = view.params;
+        params.zoom *= job.width / 800.0;
+        const std::string bufferPath = job.dir + "/" + view.name + ".iters";
+
+        GoldenBuffer golden;
+        if(job.update)
+        {
+            // The reference kernel defines the expected output
+            golden.width = job.width;
+            golden.height = job.height;
+            golden.iter = params.iter;
+            Render(Fractal::Kernels[0], params, job.width, job.height, pool, 1, golden.iters);
+            SaveBuffer(bufferPath, golden);
+        }
+        else if(!LoadBuffer(bufferPath, golden))
+        {
+            std::printf("[Golden]: %-10s FAIL  no golden buffer, run with --update\n", view.name);
+            checks++;
+            failures++;
+            continue;
+        }
+        else if(golden.width != job.width || golden.height != job.height || golden.iter != params.iter)
+        {
+            std::printf("[Golden]: %-10s FAIL  golden buffer is %dx%d with iter %d\n", view.name, golden.width,
+                        golden.height, golden.iter);
+            checks++;
+            failures++;
+            continue;
+        }
+
+        for(int k = 0; k < Fractal::KernelCount; k++)
+        {
+            const Fractal::KernelInfo& kernel = Fractal::Kernels[k];
+            if(!Selected(job.kernels, kernel))
+                continue;
+            checks++;
+            std::vector<uint32_t> iters;
+            double seconds = Render(kernel, params, job.width, job.height, pool, job.repeat, iters);
+
+            size_t mismatched = 0;
+            uint32_t maxDiff = 0;
+            for(size_t i = 0; i < iters.size(); i++)
+            {
+                uint32_t diff = iters[i] > golden.iters[i] ? iters[i] - golden.iters[i] : golden.iters[i] - iters[i];
+                if(diff)
+                    mismatched++;
+                maxDiff = std::max(maxDiff, diff);
+            }
+            const double fraction = (double)mismatched / iters.size();
+            bool ok = fraction <= job.tolerance && (mismatched == 0 || (int)maxDiff <= job.maxError);
+
+            const std::string key = std::string(kernel.name) + " " + view.name;
+            std::ostringstream timing;
+            if(job.update || !budgets.count(key))
+            {
+                // More runs than a check, so the budget is not set by one lucky or unlucky run
+                seconds = Render(kernel, params, job.width, job.height, pool, 3 * job.repeat, iters);
+                budgets[key] = seconds * (1 + job.headroom);
+                budgetsChanged = true;
+                timing << "budget " << budgets[key] * 1e3 << "ms recorded";
+            }
+            else if(job.margin >= 0)
+            {
+                // Renders of a few milliseconds get absolute slack for scheduler noise
+                const double limit = std::max(budgets[key] * (1 + job.margin), budgets[key] + 0.002);
+                // A regression must persist: one slow burst of the machine is timed again with more runs
+                if(seconds > limit)
+                    seconds = std::min(seconds, Render(kernel, params, job.width, job.height, pool,
+                                                       3 * job.repeat, iters));
+                timing << seconds * 1e3 << "ms of " << limit * 1e3 << "ms";
+                if(seconds > limit)
+                {
+                    ok = false;
+                    timing << " OVER BUDGET";
+                }
+            }
+            else
+                timing << seconds * 1e3 << "ms";
+
+            std::printf("[Golden]: %-10s %-8s %s  %zu pixels differ (max %u)  %s\n", view.name, kernel.name,
+                        ok ? "ok  " : "FAIL", mismatched, maxDiff, timing.str().c_str());
+            if(!ok)
+                failures++;
+        }
+    }
+
+    if(job.update)
+        std::printf("[Golden]: buffers written to %s\n", job.dir.c_str());
+    if(budgetsChanged)
+    {
+        SaveBudgets(budgetPath, budgets);
+        std::printf("[Golden]: budgets written to %s\n", budgetPath.c_str());
+    }
+    std::printf("[Golden]: %d of %d checks failed\n", failures, checks);
+    return failures;
+}
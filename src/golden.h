@@ -0,0 +1,35 @@
+#ifndef MANDELBROTSET_GOLDEN_H
+#define MANDELBROTSET_GOLDEN_H
+
+#include <string>
+#include <vector>
+
+// Regression check of the CPU kernels: every canonical view is rendered with every
+// kernel and compared against stored iteration buffers, and the render time against
+// a stored budget. `update` renders the reference kernel and replaces the buffers and
+// budgets instead. Budgets depend on the machine: missing ones are recorded by the
+// first check that runs, in the working directory rather than next to the buffers.
+struct GoldenJob
+{
+    std::string dir = "golden";
+    std::string budgets = "golden_budgets.txt";
+    int width = 160, height = 90;
+    unsigned threads = 0;               // 0 = all hardware threads
+    int repeat = 7;                     // the median of this many runs is timed
+    std::vector<std::string> views;     // empty = all
+    std::vector<std::string> kernels;   // empty = all
+    bool update = false;
+
+    // Allowed differences: a fraction of the pixels may differ by up to maxError iterations
+    double tolerance = 0;
+    int maxError = 0;
+    // A recorded budget is the median of 3 * repeat runs plus headroom; a render may take
+    // up to (1 + margin) times its budget. Negative disables the time check.
+    double headroom = 0.5;
+    double margin = 0.5;
+};
+
+// Returns the number of failed checks
+int RunGolden(const GoldenJob& job);
+
+#endif //MANDELBROTSET_GOLDEN_H
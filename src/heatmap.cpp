@@ -0,0 +1,63 @@
+#include "heatmap.h"
+#include "imagewriter.h"
+#include <algorithm>
+#include <stdexcept>
+
+void HeatColor(float t, uint8_t* rgb)
+{
+    t = std::min(1.0f, std::max(0.0f, t));
+    rgb[0] = (uint8_t)(255 * std::min(1.0f, t * 3));
+    rgb[1] = (uint8_t)(255 * std::min(1.0f, std::max(0.0f, t * 3 - 1)));
+    rgb[2] = (uint8_t)(255 * std::max(0.0f, t * 3 - 2));
+}
+
+TileCostMap::TileCostMap(int width, int height, int tileWidth, int tileHeight)
+    : m_width(width), m_height(height), m_tileWidth(tileWidth), m_tileHeight(tileHeight)
+{
+    if(width <= 0 || height <= 0 || tileWidth <= 0 || tileHeight <= 0)
+        throw std::runtime_error("[Heatmap]: Invalid dimensions");
+    m_tilesX = (width + tileWidth - 1) / tileWidth;
+    m_tilesY = (height + tileHeight - 1) / tileHeight;
+    m_cost.assign((size_t)m_tilesX * m_tilesY, 0.0);
+}
+
+double TileCostMap::max() const
+{
+    return *std::max_element(m_cost.begin(), m_cost.end());
+}
+
+double TileCostMap::mean() const
+{
+    double sum = 0;
+    for(double c : m_cost)
+        sum += c;
+    return sum / m_cost.size();
+}
+
+void TileCostMap::writeImage(const std::string& path, int maxSide) const
+{
+    const int scale = std::max(1, (std::max(m_width, m_height) + maxSide - 1) / maxSide);
+    const int w = (m_width + scale - 1) / scale, h = (m_height + scale - 1) / scale;
+    const double top = max();
+
+    std::vector<uint8_t> rgb((size_t)w * h * 3);
+    for(int y = 0; y < h; y++)
+    {
+        const int ty = y * scale / m_tileHeight;
+        for(int x = 0; x < w; x++)
+        {
+            const int tx = x * scale / m_tileWidth;
+            HeatColor(top > 0 ? (float)(cost(tx, ty) / top) : 0.0f, &rgb[((size_t)y * w + x) * 3]);
+        }
+    }
+    WriteImage(path, w, h, rgb.data());
+}
+
+std::string HeatmapPath(const std::string& output, const std::string& metric)
+{
+    size_t dot = output.find_last_of('.');
+    size_t slash = output.find_last_of("/\\");
+    if(dot == std::string::npos || (slash != std::string::npos && dot < slash))
+        return output + "." + metric + ".png";
+    return output.substr(0, dot) + "." + metric + ".png";
+}
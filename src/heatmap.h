@@ -0,0 +1,42 @@
+#ifndef MANDELBROTSET_HEATMAP_H
+#define MANDELBROTSET_HEATMAP_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Cold to hot color ramp (black, red, yellow, white) for t in [0, 1], the same as
+// the overlay of fragment.glsl
+void HeatColor(float t, uint8_t* rgb);
+
+// Measured cost of every tile of a width x height render, for seeing where time is
+// spent spatially. Tiles are indexed row-major from the top left; every tile is
+// written by one thread only, so concurrent add() calls on distinct tiles are safe.
+class TileCostMap
+{
+public:
+    TileCostMap(int width, int height, int tileWidth, int tileHeight);
+
+    int tilesX() const { return m_tilesX; }
+    int tilesY() const { return m_tilesY; }
+
+    void add(int tx, int ty, double cost) { m_cost[(size_t)ty * m_tilesX + tx] += cost; }
+    double cost(int tx, int ty) const { return m_cost[(size_t)ty * m_tilesX + tx]; }
+
+    double max() const;
+    double mean() const;
+
+    // Colors each pixel by the cost of its tile relative to the most expensive one.
+    // The image covers the whole render, scaled down so that no side exceeds maxSide.
+    void writeImage(const std::string& path, int maxSide = 2048) const;
+
+private:
+    int m_width, m_height, m_tileWidth, m_tileHeight;
+    int m_tilesX, m_tilesY;
+    std::vector<double> m_cost;
+};
+
+// "poster.png", "time" -> "poster.time.png"
+std::string HeatmapPath(const std::string& output, const std::string& metric);
+
+#endif //MANDELBROTSET_HEATMAP_H
@@ -0,0 +1,113 @@
+#include <GL/glew.h>
+#include <imgui.h>
+#include "heatoverlay.h"
+#include "heatmap.h"
+#include <vector>
+
+const char* HeatmapModeName(HeatmapOverlay::Mode mode)
+{
+    switch(mode)
+    {
+        case HeatmapOverlay::Iterations: return "iterations";
+        case HeatmapOverlay::Time: return "time";
+        default: return "off";
+    }
+}
+
+HeatmapOverlay::~HeatmapOverlay()
+{
+    if(m_buffers[0])
+        glDeleteBuffers(2, m_buffers);
+}
+
+void HeatmapOverlay::init()
+{
+    glGenBuffers(2, m_buffers);
+    m_timeAvailable = GLEW_ARB_shader_clock != 0;
+}
+
+void HeatmapOverlay::setMode(Mode mode)
+{
+    if(mode == Time && !m_timeAvailable)
+        mode = Off;
+    if(mode != m_mode)
+        m_valid = false;
+    m_mode = mode;
+}
+
+void HeatmapOverlay::cycleMode()
+{
+    Mode next = (Mode)((m_mode + 1) % ModeCount);
+    if(next == Time && !m_timeAvailable)
+        next = Off;
+    setMode(next);
+}
+
+void HeatmapOverlay::beginFractalPass(int width, int height)
+{
+    if(m_mode == Off)
+        return;
+
+    // Buffer layout: highest tile sum, then the tile sums row-major from the top left
+    const int tilesX = (width + TileSize - 1) / TileSize, tilesY = (height + TileSize - 1) / TileSize;
+    if(width != m_width || height != m_height)
+    {
+        const GLsizeiptr size = (1 + (GLsizeiptr)tilesX * tilesY) * sizeof(uint32_t);
+        for(uint32_t buffer : m_buffers)
+        {
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, size, nullptr, GL_DYNAMIC_COPY);
+            glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+        }
+        m_width = width;
+        m_height = height;
+        m_valid = false;
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffers[m_write]);
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_buffers[m_write]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, m_buffers[1 - m_write]);
+}
+
+void HeatmapOverlay::endFractalPass()
+{
+    if(m_mode == Off)
+        return;
+    // The next pass reads what this one wrote
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+    m_write = 1 - m_write;
+    m_valid = true;
+}
+
+bool HeatmapOverlay::dump(const std::string& path)
+{
+    if(m_mode == Off || !m_valid)
+        return false;
+
+    TileCostMap map(m_width, m_height, TileSize, TileSize);
+    std::vector<uint32_t> sums(1 + (size_t)map.tilesX() * map.tilesY());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffers[1 - m_write]);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sums.size() * sizeof(uint32_t), sums.data());
+    for(int ty = 0; ty < map.tilesY(); ty++)
+        for(int tx = 0; tx < map.tilesX(); tx++)
+            map.add(tx, ty, sums[1 + (size_t)ty * map.tilesX() + tx]);
+    map.writeImage(path);
+    return true;
+}
+
+void HeatmapOverlay::drawControls()
+{
+    int mode = m_mode;
+    ImGui::Text("Tile heatmap: ");
+    ImGui::SameLine();
+    ImGui::RadioButton("off", &mode, Off);
+    ImGui::SameLine();
+    ImGui::RadioButton("iterations", &mode, Iterations);
+    if(m_timeAvailable)
+    {
+        ImGui::SameLine();
+        ImGui::RadioButton("time", &mode, Time);
+    }
+    setMode((Mode)mode);
+}
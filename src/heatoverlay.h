@@ -0,0 +1,48 @@
+#ifndef MANDELBROTSET_HEATOVERLAY_H
+#define MANDELBROTSET_HEATOVERLAY_H
+
+#include <cstdint>
+#include <string>
+
+// Debug view of the window that colors every 16x16 tile by what it cost to compute
+// instead of by the palette. The fragment shader sums the cost of its tile into one
+// storage buffer while coloring from the sums of the previous frame in another, so
+// the overlay lags one frame but never waits for the GPU. Needs a current GL 4.4 context.
+class HeatmapOverlay
+{
+public:
+    // Matches the `heatmap` uniform of fragment.glsl
+    enum Mode { Off, Iterations, Time, ModeCount };
+    static const int TileSize = 16;
+
+    ~HeatmapOverlay();
+
+    void init();
+    Mode mode() const { return m_mode; }
+    void setMode(Mode mode);
+    void cycleMode();
+    // Time needs the shader clock (GL_ARB_shader_clock), iterations are always available
+    bool timeAvailable() const { return m_timeAvailable; }
+
+    // Bracket the fractal draw call. Binds the tile sums to storage buffer bindings 2
+    // (written this frame) and 3 (read, from the previous frame).
+    void beginFractalPass(int width, int height);
+    void endFractalPass();
+
+    // Writes the last complete tile sums as an image; returns false when there is nothing to write
+    bool dump(const std::string& path);
+
+    void drawControls();
+
+private:
+    Mode m_mode = Off;
+    bool m_timeAvailable = false;
+    uint32_t m_buffers[2] = { 0, 0 };
+    int m_write = 0;
+    int m_width = 0, m_height = 0;
+    bool m_valid = false;   // the read buffer holds a complete frame of the current size and mode
+};
+
+const char* HeatmapModeName(HeatmapOverlay::Mode mode);
+
+#endif //MANDELBROTSET_HEATOVERLAY_H
@@ -0,0 +1,72 @@
+#include "imagewriter.h"
+#include "fileutil.h"
+#include <stdexcept>
+
+PPMWriter::PPMWriter(const std::string& path, int width, int height, const WriterCheckpoint* resume)
+    :ImageWriter(width, height)
+{
+    if(resume)
+    {
+        m_file = ReopenTruncated(path, resume->fileSize);
+        if(!m_file)
+            throw std::runtime_error("[PPM]: Could not resume " + path);
+        m_rowsWritten = resume->rows;
+        return;
+    }
+
+    m_file = std::fopen(path.c_str(), "wb");
+    if(!m_file)
+        throw std::runtime_error("[PPM]: Could not open " + path + " for writing");
+    std::fprintf(m_file, "P6\n%d %d\n255\n", width, height);
+}
+
+PPMWriter::~PPMWriter()
+{
+    if(m_file)
+        std::fclose(m_file);
+}
+
+void PPMWriter::writeRows(const uint8_t* rgb, int rows)
+{
+    size_t bytes = (size_t)m_width * 3 * rows;
+    if(std::fwrite(rgb, 1, bytes, m_file) != bytes)
+        throw std::runtime_error("[PPM]: Write failed");
+    m_rowsWritten += rows;
+}
+
+WriterCheckpoint PPMWriter::checkpoint()
+{
+    SyncFile(m_file);
+    WriterCheckpoint state;
+    state.fileSize = FilePosition(m_file);
+    state.rows = m_rowsWritten;
+    return state;
+}
+
+void PPMWriter::finish()
+{
+    if(std::fclose(m_file) != 0)
+    {
+        m_file = nullptr;
+        throw std::runtime_error("[PPM]: Write failed");
+    }
+    m_file = nullptr;
+}
+
+std::unique_ptr<ImageWriter> CreateImageWriter(const std::string& path, int width, int height, unsigned threads,
+                                               const WriterCheckpoint* resume)
+{
+    std::string ext = path.size() >= 4 ? path.substr(path.size() - 4) : "";
+    if(ext == ".ppm")
+        return std::unique_ptr<ImageWriter>(new PPMWriter(path, width, height, resume));
+    if(ext == ".png")
+        return std::unique_ptr<ImageWriter>(new PNGWriter(path, width, height, threads, resume));
+    throw std::runtime_error("[Image]: Unsupported output format: " + path);
+}
+
+void WriteImage(const std::string& path, int width, int height, const uint8_t* rgb, unsigned threads)
+{
+    std::unique_ptr<ImageWriter> writer = CreateImageWriter(path, width, height, threads);
+    writer->writeRows(rgb, height);
+    writer->finish();
+}
@@ -0,0 +1,92 @@
+#ifndef MANDELBROTSET_IMAGEWRITER_H
+#define MANDELBROTSET_IMAGEWRITER_H
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Encoder state at a row boundary: enough to reopen a partially written file
+// and continue it exactly as if the encoder had never stopped
+struct WriterCheckpoint
+{
+    uint64_t fileSize = 0;
+    int rows = 0;
+    uint32_t adler = 1;
+    std::vector<uint8_t> prevRow;
+};
+
+// Streaming sink for 8-bit RGB images written top to bottom
+class ImageWriter
+{
+public:
+    ImageWriter(int width, int height) : m_width(width), m_height(height) {}
+    virtual ~ImageWriter() = default;
+
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+
+    // Appends `rows` packed RGB rows
+    virtual void writeRows(const uint8_t* rgb, int rows) = 0;
+    virtual void finish() = 0;
+    // Flushes everything written so far to the disk and returns the state to resume from
+    virtual WriterCheckpoint checkpoint() = 0;
+
+protected:
+    int m_width, m_height;
+};
+
+// Binary PPM (P6)
+class PPMWriter : public ImageWriter
+{
+public:
+    // With `resume` the existing file is truncated to the checkpoint and continued
+    PPMWriter(const std::string& path, int width, int height, const WriterCheckpoint* resume = nullptr);
+    ~PPMWriter() override;
+
+    void writeRows(const uint8_t* rgb, int rows) override;
+    void finish() override;
+    WriterCheckpoint checkpoint() override;
+
+private:
+    FILE* m_file;
+    int m_rowsWritten = 0;
+};
+
+class ThreadPool;
+
+// PNG (8-bit RGB). Each batch of rows is split into row blocks that are filtered
+// and deflated on a thread pool as independent deflate streams, then concatenated.
+// The output depends only on the image and on how it was split into writeRows() calls.
+class PNGWriter : public ImageWriter
+{
+public:
+    // 0 threads means one per hardware thread
+    // With `resume` the existing file is truncated to the checkpoint and continued
+    PNGWriter(const std::string& path, int width, int height, unsigned threads = 0,
+              const WriterCheckpoint* resume = nullptr);
+    ~PNGWriter() override;
+
+    void writeRows(const uint8_t* rgb, int rows) override;
+    void finish() override;
+    WriterCheckpoint checkpoint() override;
+
+private:
+    void writeChunk(const char* type, const uint8_t* data, size_t size);
+
+    FILE* m_file;
+    std::unique_ptr<ThreadPool> m_pool;
+    std::vector<uint8_t> m_prevRow;
+    uint32_t m_adler = 1;
+    int m_rowsWritten = 0;
+};
+
+// Picks the encoder from the file extension; `threads` is used by encoders that can run in parallel
+std::unique_ptr<ImageWriter> CreateImageWriter(const std::string& path, int width, int height, unsigned threads = 0,
+                                               const WriterCheckpoint* resume = nullptr);
+
+// Writes a whole packed RGB image in one go, by default on the calling thread only
+void WriteImage(const std::string& path, int width, int height, const uint8_t* rgb, unsigned threads = 1);
+
+#endif //MANDELBROTSET_IMAGEWRITER_H
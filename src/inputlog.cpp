@@ -0,0 +1,60 @@
+#include "inputlog.h"
+#include <stdexcept>
+#include <iomanip>
+
+namespace
+{
+    const char* InputMagic = "MandelbrotSet input 1";
+}
+
+InputRecorder::InputRecorder(const std::string& path, int width, int height)
+    : m_out(path, std::ios::trunc)
+{
+    if(!m_out.is_open())
+        throw std::runtime_error("[Input]: Could not create " + path);
+    m_out << InputMagic << "\n" << width << " " << height << "\n" << std::setprecision(17);
+}
+
+void InputRecorder::start()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_start = std::chrono::steady_clock::now();
+    m_started = true;
+}
+
+void InputRecorder::record(InputEvent event)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    event.time = m_started ? std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count() : 0;
+    // frame time type code action mods x y
+    m_out << event.frame << " " << event.time << " " << event.type << " " << event.code << " " << event.action
+          << " " << event.mods << " " << event.x << " " << event.y << "\n";
+    // Keep the file usable when the window is closed abruptly
+    m_out.flush();
+}
+
+InputReplay::InputReplay(const std::string& path)
+{
+    std::ifstream in(path);
+    std::string magic;
+    if(!std::getline(in, magic) || magic != InputMagic || !(in >> m_width >> m_height))
+        throw std::runtime_error("[Input]: " + path + " is not an input recording");
+
+    InputEvent e;
+    while(in >> e.frame >> e.time >> e.type >> e.code >> e.action >> e.mods >> e.x >> e.y)
+        m_events.push_back(e);
+    if(!in.eof())
+        throw std::runtime_error("[Input]: " + path + " is damaged after " + std::to_string(m_events.size()) + " events");
+}
+
+bool InputReplay::next(uint64_t frame, double time, bool byFrame, InputEvent& event)
+{
+    if(finished())
+        return false;
+    const InputEvent& e = m_events[m_next];
+    if(byFrame ? e.frame > frame : e.time > time)
+        return false;
+    event = e;
+    m_next++;
+    return true;
+}
@@ -0,0 +1,65 @@
+#ifndef MANDELBROTSET_INPUTLOG_H
+#define MANDELBROTSET_INPUTLOG_H
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// One GLFW input callback of the window, or one tick of its fixed update, with
+// everything the handler reads so that it can be replayed without the devices
+struct InputEvent
+{
+    enum Type { Key, MouseButton, CursorPos, Scroll, FixedUpdate };
+
+    int type = Key;
+    uint64_t frame = 0;         // frames completed before the event
+    double time = 0;            // seconds since the first frame started
+    int code = 0;               // key or mouse button
+    int action = 0, mods = 0;   // for Scroll, mods is 1 while S is held
+    double x = 0, y = 0;        // cursor position or scroll offset
+};
+
+// Appends events to a text file, one per line. record() may be called from any thread.
+class InputRecorder
+{
+public:
+    InputRecorder(const std::string& path, int width, int height);
+
+    // Starts the clock when the first frame begins, where a replay starts its own
+    void start();
+
+    // Stamps the event with the time since start(), or 0 before it
+    void record(InputEvent event);
+
+private:
+    std::ofstream m_out;
+    std::mutex m_mutex;
+    bool m_started = false;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+// Events of a recording, handed out either by frame (as fast as frames can be
+// rendered, identical on every run) or by time (at the recorded speed)
+class InputReplay
+{
+public:
+    explicit InputReplay(const std::string& path);
+
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+
+    // Next event due by the end of `frame` (byFrame) or by `time` seconds into the replay
+    bool next(uint64_t frame, double time, bool byFrame, InputEvent& event);
+    bool finished() const { return m_next == m_events.size(); }
+    size_t size() const { return m_events.size(); }
+
+private:
+    int m_width = 0, m_height = 0;
+    std::vector<InputEvent> m_events;
+    size_t m_next = 0;
+};
+
+#endif //MANDELBROTSET_INPUTLOG_H
@@ -0,0 +1,41 @@
+#include "iterstats.h"
+#include <algorithm>
+
+void IterationStats::add(const uint32_t* iters, size_t count)
+{
+    if(iter <= 0)
+        return;
+    pixels += count;
+    for(size_t i = 0; i < count; i++)
+    {
+        uint32_t n = iters[i];
+        total += n;
+        if((int)n >= iter)
+            bounded++;
+        else
+        {
+            histogram[Bin(n, iter)]++;
+            maxEscape = std::max(maxEscape, n);
+        }
+    }
+}
+
+IterationStats& IterationStats::operator+=(const IterationStats& other)
+{
+    if(iter == 0)
+        iter = other.iter;
+    pixels += other.pixels;
+    bounded += other.bounded;
+    total += other.total;
+    maxEscape = std::max(maxEscape, other.maxEscape);
+    for(int b = 0; b < Bins; b++)
+        histogram[b] += other.histogram[b];
+    return *this;
+}
+
+double IterationStats::meanEscape() const
+{
+    // Everything not spent on bounded pixels was spent on escaping ones
+    uint64_t escaped = pixels - bounded;
+    return escaped ? (double)(total - bounded * (uint64_t)iter) / escaped : 0.0;
+}
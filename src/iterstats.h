@@ -0,0 +1,33 @@
+#ifndef MANDELBROTSET_ITERSTATS_H
+#define MANDELBROTSET_ITERSTATS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Distribution of the iteration counts of a render, for choosing `iter`: how many
+// pixels reach the limit (cost without detail) and where the escaping ones stop.
+// Partial statistics of tiles or threads are merged with +=.
+struct IterationStats
+{
+    // Escape iterations [0, iter) are binned linearly; fragment.glsl uses the same bins
+    static const int Bins = 64;
+    static int Bin(uint32_t n, int iter) { return (int)((uint64_t)n * Bins / (uint32_t)iter); }
+
+    int iter = 0;
+    uint64_t pixels = 0;
+    uint64_t bounded = 0;       // pixels that reached iter
+    uint64_t total = 0;         // iterations spent (sum of the counts)
+    uint32_t maxEscape = 0;     // highest count below iter
+    uint64_t histogram[Bins] = {};
+
+    explicit IterationStats(int iter = 0) : iter(iter) {}
+
+    void add(const uint32_t* iters, size_t count);
+    IterationStats& operator+=(const IterationStats& other);
+
+    double boundedFraction() const { return pixels ? (double)bounded / pixels : 0.0; }
+    double meanEscape() const;
+};
+
+#endif //MANDELBROTSET_ITERSTATS_H
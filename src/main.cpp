@@ -8,20 +8,41 @@ R -> Reset
 N -> Change Loaded Texture
 F -> Trigger Freq Animation
 G -> Trigger UV Animation
-(TODO) Show FPS
+P -> Save a Chrome trace to trace.json (builds with MANDELBROT_PROFILE)
+A -> Show performance panel
+H -> Cycle tile heatmap overlay (off / iterations / time)
+J -> Save the tile heatmap as heatmap.<metric>.png
 (TODO) Load custom settings
+
+Headless batch modes: run with "help" for the list of commands
+
+Window options:
+--record FILE                   save the key, mouse button, cursor and scroll
+                                callbacks of the session
+--replay FILE [--max-speed]     play it back instead of the live input, then
+              [--report CSV]    print frame time statistics and exit
 */
 
 #include "App.h"
+#include "batch.h"
+#include "options.h"
 #include <iostream>
 
 using namespace std;
 
-int main()
+int main(int argc, char** argv)
 {
     try
     {
+        if(argc > 1 && IsBatchCommand(argv[1]))
+            return RunBatch(argc, argv);
+
         auto& app = App::getInstance();
+        Options opt(argc, argv, 1);
+        if(opt.has("record"))
+            app.recordInput(opt.get("record"));
+        if(opt.has("replay"))
+            app.replayInput(opt.get("replay"), opt.has("max-speed"), opt.get("report"));
         app.initWindow();
         app.run();
     }
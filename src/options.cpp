@@ -0,0 +1,73 @@
+#include "options.h"
+#include <stdexcept>
+#include <cstdlib>
+#include <cstdio>
+
+Options::Options(int argc, char** argv, int first)
+{
+    for(int i = first; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if(arg.size() > 2 && arg[0] == '-' && arg[1] == '-')
+        {
+            std::string name = arg.substr(2);
+            std::string next = i + 1 < argc ? argv[i + 1] : "";
+            if(i + 1 < argc && next.compare(0, 2, "--") != 0)
+            {
+                m_values[name] = next;
+                i++;
+            }
+            else
+                m_values[name] = "";
+        }
+        else
+            m_positional.push_back(arg);
+    }
+}
+
+bool Options::has(const std::string& name) const
+{
+    return m_values.count(name) != 0;
+}
+
+std::string Options::get(const std::string& name, const std::string& def) const
+{
+    auto it = m_values.find(name);
+    return it == m_values.end() ? def : it->second;
+}
+
+int Options::getInt(const std::string& name, int def) const
+{
+    auto it = m_values.find(name);
+    if(it == m_values.end())
+        return def;
+    char* end;
+    long v = std::strtol(it->second.c_str(), &end, 10);
+    if(end == it->second.c_str() || *end)
+        throw std::runtime_error("[Options]: --" + name + " expects an integer");
+    return (int)v;
+}
+
+double Options::getDouble(const std::string& name, double def) const
+{
+    auto it = m_values.find(name);
+    if(it == m_values.end())
+        return def;
+    char* end;
+    double v = std::strtod(it->second.c_str(), &end);
+    if(end == it->second.c_str() || *end)
+        throw std::runtime_error("[Options]: --" + name + " expects a number");
+    return v;
+}
+
+void Options::getSize(const std::string& name, int& width, int& height) const
+{
+    auto it = m_values.find(name);
+    if(it == m_values.end())
+        return;
+    int w, h;
+    if(std::sscanf(it->second.c_str(), "%dx%d", &w, &h) != 2 || w <= 0 || h <= 0)
+        throw std::runtime_error("[Options]: --" + name + " expects WIDTHxHEIGHT");
+    width = w;
+    height = h;
+}
@@ -0,0 +1,28 @@
+#ifndef MANDELBROTSET_OPTIONS_H
+#define MANDELBROTSET_OPTIONS_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+// Minimal "--name value" / "--flag" command line parser for the batch modes
+class Options
+{
+public:
+    Options(int argc, char** argv, int first);
+
+    bool has(const std::string& name) const;
+    std::string get(const std::string& name, const std::string& def = "") const;
+    int getInt(const std::string& name, int def) const;
+    double getDouble(const std::string& name, double def) const;
+    // Parses "WIDTHxHEIGHT"
+    void getSize(const std::string& name, int& width, int& height) const;
+
+    const std::vector<std::string>& positional() const { return m_positional; }
+
+private:
+    std::map<std::string, std::string> m_values;
+    std::vector<std::string> m_positional;
+};
+
+#endif //MANDELBROTSET_OPTIONS_H
@@ -0,0 +1,55 @@
+#include "palette.h"
+#include "assets.h"
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <stb_image.h>
+
+Palette::Palette(const char* path)
+{
+    load(path);
+}
+
+void Palette::load(const char* path)
+{
+    if(const EmbeddedPalette* embedded = Assets::FindPalette(path))
+    {
+        m_texels.assign(embedded->rgba, embedded->rgba + (size_t)embedded->width * 4);
+        return;
+    }
+
+    int width, height, bpp;
+    const std::string diskPath = Assets::DiskPath(path);
+    unsigned char* data = stbi_load(diskPath.c_str(), &width, &height, &bpp, 4);
+    if(!data)
+        throw std::runtime_error("[Palette]: Could not load " + diskPath);
+
+    // LoadPNG_1D() flips the image and uploads the first row, i.e. the bottom one
+    const unsigned char* row = data + (size_t)(height - 1) * width * 4;
+    m_texels.assign(row, row + (size_t)width * 4);
+    stbi_image_free(data);
+}
+
+void Palette::color(uint32_t t, int iter, float freq, float UVoffset, uint8_t* rgb) const
+{
+    if((int)t == iter || m_texels.empty())
+    {
+        rgb[0] = rgb[1] = rgb[2] = 0;
+        return;
+    }
+    float s = float(t) / freq + UVoffset;
+    s -= std::floor(s);
+    int w = size();
+    int i = (int)(s * w);
+    if(i >= w) i = w - 1;
+    const uint8_t* c = texel(i);
+    rgb[0] = c[0];
+    rgb[1] = c[1];
+    rgb[2] = c[2];
+}
+
+void Palette::colorize(const uint32_t* iters, size_t count, int iter, float freq, float UVoffset, uint8_t* rgb) const
+{
+    for(size_t i = 0; i < count; i++)
+        color(iters[i], iter, freq, UVoffset, rgb + i * 3);
+}
@@ -0,0 +1,30 @@
+#ifndef MANDELBROTSET_PALETTE_H
+#define MANDELBROTSET_PALETTE_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// CPU copy of a 1D gradient texture, sampled the same way the fragment shader
+// samples its sampler1D (nearest filtering, repeat wrapping).
+class Palette
+{
+public:
+    Palette() = default;
+    explicit Palette(const char* path);
+
+    void load(const char* path);
+    int size() const { return (int)m_texels.size() / 4; }
+    const uint8_t* texel(int i) const { return &m_texels[(size_t)i * 4]; }
+
+    // Writes the RGB color of an iteration count, black for points inside the set
+    void color(uint32_t t, int iter, float freq, float UVoffset, uint8_t* rgb) const;
+
+    // Colors `count` iteration values into packed RGB
+    void colorize(const uint32_t* iters, size_t count, int iter, float freq, float UVoffset, uint8_t* rgb) const;
+
+private:
+    std::vector<uint8_t> m_texels; // RGBA
+};
+
+#endif //MANDELBROTSET_PALETTE_H
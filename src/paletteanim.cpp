@@ -0,0 +1,174 @@
+#include "paletteanim.h"
+#include "palette.h"
+#include "threadpool.h"
+#include "boundedqueue.h"
+#include "y4mwriter.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // Same rates as App::onFixedUpdate(), which runs every 10 ms
+    const float UVoffsetCoef = 0.002f;
+    const float freqCoef = 1.001f;
+    const int TicksPerSecond = 100;
+
+    const int BandRows = 16;
+
+    // Per-frame color lookup by iteration count, directly in YUV. Chroma is kept
+    // in 8.8 fixed point so that 2x2 blocks can be averaged before rounding.
+    struct ColorTable
+    {
+        std::vector<uint8_t> Y;
+        std::vector<int32_t> U, V;
+
+        void build(const Palette& palette, int iter, float freq, float UVoffset)
+        {
+            Y.resize(iter + 1);
+            U.resize(iter + 1);
+            V.resize(iter + 1);
+            for(int t = 0; t <= iter; t++)
+            {
+                uint8_t c[3];
+                palette.color((uint32_t)t, iter, freq, UVoffset, c);
+                float y = 0.299f * c[0] + 0.587f * c[1] + 0.114f * c[2];
+                Y[t] = (uint8_t)std::min(255.0f, y + 0.5f);
+                U[t] = (int32_t)((-0.168736f * c[0] - 0.331264f * c[1] + 0.5f * c[2] + 128) * 256);
+                V[t] = (int32_t)((0.5f * c[0] - 0.418688f * c[1] - 0.081312f * c[2] + 128) * 256);
+            }
+        }
+    };
+
+    uint8_t AverageChroma(int32_t sum, int count)
+    {
+        int32_t v = (sum + count * 128) / (count * 256);
+        return (uint8_t)std::min(std::max(v, 0), 255);
+    }
+
+    // Colors chroma rows [cy0, cy0 + rows) and the luma rows they cover
+    void ColorBand(const ColorTable& table, const uint32_t* iters, int width, int height, int cy0, int rows,
+                   uint8_t* yuv)
+    {
+        const int cw = (width + 1) / 2, ch = (height + 1) / 2;
+        uint8_t* Y = yuv;
+        uint8_t* U = Y + (size_t)width * height;
+        uint8_t* V = U + (size_t)cw * ch;
+
+        for(int y = 2 * cy0; y < std::min(2 * (cy0 + rows), height); y++)
+        {
+            const uint32_t* in = iters + (size_t)y * width;
+            uint8_t* out = Y + (size_t)y * width;
+            for(int x = 0; x < width; x++)
+                out[x] = table.Y[in[x]];
+        }
+
+        for(int cy = cy0; cy < cy0 + rows; cy++)
+        {
+            const uint32_t* r0 = iters + (size_t)(2 * cy) * width;
+            const uint32_t* r1 = 2 * cy + 1 < height ? r0 + width : r0;
+            for(int cx = 0; cx < cw; cx++)
+            {
+                const int x0 = 2 * cx, x1 = std::min(2 * cx + 1, width - 1);
+                int32_t u = table.U[r0[x0]] + table.U[r0[x1]] + table.U[r1[x0]] + table.U[r1[x1]];
+                int32_t v = table.V[r0[x0]] + table.V[r0[x1]] + table.V[r1[x0]] + table.V[r1[x1]];
+                U[(size_t)cy * cw + cx] = AverageChroma(u, 4);
+                V[(size_t)cy * cw + cx] = AverageChroma(v, 4);
+            }
+        }
+    }
+}
+
+void RenderPaletteAnimation(const PaletteAnimationJob& job)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    Palette palette(job.palette.c_str());
+    ThreadPool pool(job.threads);
+    Y4MWriter writer(job.output, job.width, job.height, job.fps);
+
+    FractalParams params = job.params;
+    params.zoom *= (double)job.width / job.viewWidth;
+
+    // The only fractal computation of the whole animation
+    Clock::time_point start = Clock::now();
+    std::vector<uint32_t> iters((size_t)job.width * job.height);
+    const int bands = (job.height + BandRows - 1) / BandRows;
+    pool.parallelFor(bands, [&](int band, unsigned)
+    {
+        const int y0 = band * BandRows;
+        Fractal::RenderIterations(params, job.width, job.height, 0, y0, job.width, std::min(BandRows, job.height - y0),
+                                  iters.data() + (size_t)y0 * job.width, job.width);
+    });
+    const double renderTime = std::chrono::duration<double>(Clock::now() - start).count();
+    std::fprintf(stderr, "[Palette]: iteration buffer %dx%d computed in %.2fs\n", job.width, job.height, renderTime);
+
+    // Frame N+1 is colored while frame N is written
+    BoundedQueue<std::vector<uint8_t>> toWrite(2);
+    std::exception_ptr writeError;
+    std::thread writeThread([&]
+    {
+        std::vector<uint8_t> yuv;
+        while(toWrite.pop(yuv))
+        {
+            if(writeError)
+                continue;
+            try { writer.writeFrameYUV(yuv.data()); }
+            catch(...) { writeError = std::current_exception(); }
+        }
+    });
+
+    // Fixed update ticks that fall into each frame; fractional rates carry over
+    const double ticksPerFrame = TicksPerSecond / (double)job.fps;
+    double ticks = 0;
+    const int chromaRows = (job.height + 1) / 2;
+    const int chromaBands = (chromaRows + BandRows - 1) / BandRows;
+    float freq = params.freq, UVoffset = params.UVoffset;
+    int freqDir = 1;
+    ColorTable table;
+
+    Clock::time_point colorStart = Clock::now();
+    for(int n = 0; n < job.frames; n++)
+    {
+        table.build(palette, params.iter, freq, UVoffset);
+        std::vector<uint8_t> yuv(writer.frameBytes());
+        pool.parallelFor(chromaBands, [&](int band, unsigned)
+        {
+            const int cy0 = band * BandRows;
+            ColorBand(table, iters.data(), job.width, job.height, cy0, std::min(BandRows, chromaRows - cy0), yuv.data());
+        });
+        toWrite.push(std::move(yuv));
+
+        for(ticks += ticksPerFrame; ticks >= 1; ticks -= 1)
+        {
+            if(job.animateFreq)
+            {
+                if(freq > params.iter) freqDir = -1;
+                else if(freq < 30.0f)
+                {
+                    freqDir = 1;
+                    freq = 30.0f;
+                }
+                if(freqDir > 0) freq *= freqCoef;
+                else freq /= freqCoef;
+            }
+            if(job.animateUV)
+            {
+                UVoffset += UVoffsetCoef;
+                if(UVoffset > 1.0f) UVoffset = 0.0f;
+            }
+        }
+    }
+    toWrite.close();
+    writeThread.join();
+    if(writeError)
+        std::rethrow_exception(writeError);
+    writer.finish();
+
+    const double colorTime = std::chrono::duration<double>(Clock::now() - colorStart).count();
+    std::fprintf(stderr, "[Palette]: %d frames colored and written in %.2fs (%.1f fps)\n", job.frames, colorTime,
+                 job.frames / colorTime);
+}
@@ -0,0 +1,25 @@
+#ifndef MANDELBROTSET_PALETTEANIM_H
+#define MANDELBROTSET_PALETTEANIM_H
+
+#include <string>
+#include "fractal.h"
+
+// Headless version of the "F" (frequency) and "G" (UV offset) animations.
+// Both only remap colors, so the fractal is computed exactly once.
+struct PaletteAnimationJob
+{
+    FractalParams params;
+    int width = 1280, height = 720;
+    int viewWidth = 800;
+    int frames = 300;
+    int fps = 30;
+    bool animateUV = true;
+    bool animateFreq = false;
+    unsigned threads = 0;
+    std::string palette = "img/pal.png";
+    std::string output = "palette.y4m";  // "-" for stdout
+};
+
+void RenderPaletteAnimation(const PaletteAnimationJob& job);
+
+#endif //MANDELBROTSET_PALETTEANIM_H
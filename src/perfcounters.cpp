@@ -0,0 +1,133 @@
+#include "perfcounters.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+const char* PerfEventName(int event)
+{
+    static const char* names[PerfEventCount] = { "cycles", "instructions", "branch_misses", "cache_misses" };
+    return names[event];
+}
+
+double PerfCounts::ipc() const
+{
+    if(!has(PerfCycles) || !has(PerfInstructions) || value[PerfCycles] == 0)
+        return 0;
+    return (double)value[PerfInstructions] / value[PerfCycles];
+}
+
+PerfCounts& PerfCounts::operator+=(const PerfCounts& other)
+{
+    // An event is only meaningful in a sum if every part had it
+    available = available ? available & other.available : other.available;
+    for(int e = 0; e < PerfEventCount; e++)
+        value[e] += other.value[e];
+    return *this;
+}
+
+#ifdef __linux__
+
+PerfCounters::PerfCounters()
+{
+    static const uint64_t configs[PerfEventCount] =
+    {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_BRANCH_MISSES, PERF_COUNT_HW_CACHE_MISSES
+    };
+
+    // One group, so all events are scheduled together; events that cannot join are skipped
+    for(int e = 0; e < PerfEventCount; e++)
+    {
+        m_fds[e] = -1;
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = configs[e];
+        attr.disabled = m_leader < 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        int fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, m_leader, 0);
+        if(fd < 0)
+        {
+            if(m_error.empty())
+                m_error = std::string(PerfEventName(e)) + ": " + std::strerror(errno);
+            continue;
+        }
+        ioctl(fd, PERF_EVENT_IOC_ID, &m_ids[e]);
+        if(m_leader < 0)
+            m_leader = fd;
+        m_fds[e] = fd;
+        m_available |= 1u << e;
+    }
+}
+
+PerfCounters::~PerfCounters()
+{
+    for(int fd : m_fds)
+        if(fd >= 0)
+            close(fd);
+}
+
+void PerfCounters::start()
+{
+    if(m_leader < 0)
+        return;
+    ioctl(m_leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(m_leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+PerfCounts PerfCounters::stop()
+{
+    PerfCounts counts;
+    if(m_leader < 0)
+        return counts;
+    ioctl(m_leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+    // { nr, time_enabled, time_running, { value, id } * nr }
+    uint64_t data[3 + 2 * PerfEventCount];
+    if(read(m_leader, data, sizeof(data)) < (ssize_t)(3 * sizeof(uint64_t)))
+        return counts;
+    double scale = data[2] > 0 ? (double)data[1] / data[2] : 1.0;
+    for(uint64_t i = 0; i < data[0] && i < PerfEventCount; i++)
+    {
+        for(int e = 0; e < PerfEventCount; e++)
+        {
+            if(m_fds[e] >= 0 && m_ids[e] == data[4 + 2*i])
+            {
+                counts.value[e] = (uint64_t)(data[3 + 2*i] * scale);
+                counts.available |= 1u << e;
+            }
+        }
+    }
+    return counts;
+}
+
+#else
+
+PerfCounters::PerfCounters()
+{
+    for(int e = 0; e < PerfEventCount; e++)
+        m_fds[e] = -1;
+    m_error = "hardware counters are only supported on Linux";
+}
+
+PerfCounters::~PerfCounters() = default;
+
+void PerfCounters::start()
+{
+}
+
+PerfCounts PerfCounters::stop()
+{
+    return PerfCounts();
+}
+
+#endif
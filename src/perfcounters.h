@@ -0,0 +1,50 @@
+#ifndef MANDELBROTSET_PERFCOUNTERS_H
+#define MANDELBROTSET_PERFCOUNTERS_H
+
+#include <cstdint>
+#include <string>
+
+enum PerfEvent { PerfCycles, PerfInstructions, PerfBranchMisses, PerfCacheMisses, PerfEventCount };
+
+const char* PerfEventName(int event);
+
+// Hardware event counts. Events the machine or the permissions do not allow
+// are missing from `available`.
+struct PerfCounts
+{
+    uint64_t value[PerfEventCount] = {};
+    unsigned available = 0;     // bit per PerfEvent
+
+    bool has(int event) const { return (available >> event) & 1; }
+    double ipc() const;
+    PerfCounts& operator+=(const PerfCounts& other);
+};
+
+// Counters of the thread that constructs the object, read through perf_event_open
+// on Linux. Elsewhere, or when the kernel refuses (perf_event_paranoid, containers,
+// virtual machines), available() is false and stop() returns empty counts.
+class PerfCounters
+{
+public:
+    PerfCounters();
+    ~PerfCounters();
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool available() const { return m_available != 0; }
+    // Why no counter could be opened
+    const std::string& error() const { return m_error; }
+
+    void start();
+    // Counts since start(), scaled up if the kernel had to multiplex the counters
+    PerfCounts stop();
+
+private:
+    int m_fds[PerfEventCount];
+    uint64_t m_ids[PerfEventCount];
+    int m_leader = -1;
+    unsigned m_available = 0;
+    std::string m_error;
+};
+
+#endif //MANDELBROTSET_PERFCOUNTERS_H
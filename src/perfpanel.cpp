@@ -0,0 +1,229 @@
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <imgui.h>
+#include "perfpanel.h"
+#include <algorithm>
+#include <cfloat>
+#include <iostream>
+
+void SlidingWindow::push(float value)
+{
+    m_values.push_back(value);
+    if(m_values.size() > m_capacity)
+        m_values.pop_front();
+}
+
+float SlidingWindow::percentile(float p) const
+{
+    if(m_values.empty())
+        return 0;
+    std::vector<float> sorted(m_values.begin(), m_values.end());
+    size_t k = std::min(sorted.size() - 1, (size_t)(p * (sorted.size() - 1) + 0.5f));
+    std::nth_element(sorted.begin(), sorted.begin() + k, sorted.end());
+    return sorted[k];
+}
+
+float SlidingWindow::mean() const
+{
+    if(m_values.empty())
+        return 0;
+    double sum = 0;
+    for(float v : m_values)
+        sum += v;
+    return (float)(sum / m_values.size());
+}
+
+PerfPanel::PerfPanel()
+    : m_frameMs(300), m_passMs(300), m_iterations(300)
+{
+}
+
+PerfPanel::~PerfPanel()
+{
+    stopLog();
+}
+
+void PerfPanel::init()
+{
+    for(Slot& slot : m_slots)
+    {
+        glGenQueries(1, &slot.query);
+        // 64-bit total as two 32-bit words, the shader carries into the high one
+        glGenBuffers(1, &slot.counter);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, slot.counter);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, 2 * sizeof(uint32_t), nullptr, GL_DYNAMIC_READ);
+        // bounded, maxEscape, bins
+        glGenBuffers(1, &slot.histogram);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, slot.histogram);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, (2 + IterationStats::Bins) * sizeof(uint32_t), nullptr, GL_DYNAMIC_READ);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    m_lastFrameStart = glfwGetTime();
+}
+
+void PerfPanel::beginFrame()
+{
+    double now = glfwGetTime();
+    m_lastFrameMs = (float)((now - m_lastFrameStart) * 1000.0);
+    m_lastFrameStart = now;
+    m_frameMs.push(m_lastFrameMs);
+    collect();
+}
+
+void PerfPanel::beginFractalPass()
+{
+    Slot& slot = m_slots[m_current];
+    if(slot.pending)
+    {
+        // The GPU is more than Slots frames behind; drop the oldest measurement
+        slot.pending = false;
+    }
+    if(m_countIterations)
+    {
+        const uint32_t zero[2 + IterationStats::Bins] = {};
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, slot.counter);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, 2 * sizeof(uint32_t), zero);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, slot.counter);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, slot.histogram);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(zero), zero);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, slot.histogram);
+    }
+    glBeginQuery(GL_TIME_ELAPSED, slot.query);
+}
+
+void PerfPanel::endFractalPass()
+{
+    glEndQuery(GL_TIME_ELAPSED);
+    Slot& slot = m_slots[m_current];
+    slot.pending = true;
+    slot.counted = m_countIterations;
+}
+
+void PerfPanel::endFrame(int width, int height, int iter, double zoom)
+{
+    Slot& slot = m_slots[m_current];
+    slot.frame = m_frame++;
+    slot.width = width;
+    slot.height = height;
+    slot.iter = iter;
+    slot.zoom = zoom;
+    slot.frameMs = m_lastFrameMs;
+    m_current = (m_current + 1) % Slots;
+}
+
+void PerfPanel::collect()
+{
+    // Oldest first from the slot written next, so the CSV stays in frame order
+    for(int i = 0; i < Slots; i++)
+    {
+        Slot& slot = m_slots[(m_current + i) % Slots];
+        if(!slot.pending)
+            continue;
+        GLint available = 0;
+        glGetQueryObjectiv(slot.query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if(!available)
+            break;
+        slot.pending = false;
+
+        GLuint64 ns = 0;
+        glGetQueryObjectui64v(slot.query, GL_QUERY_RESULT, &ns);
+        float passMs = (float)(ns * 1e-6);
+        m_passMs.push(passMs);
+
+        uint64_t iterations = 0;
+        if(slot.counted)
+        {
+            uint32_t words[2];
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, slot.counter);
+            glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(words), words);
+            iterations = ((uint64_t)words[1] << 32) | words[0];
+            m_iterations.push((float)iterations);
+            m_lastIterationsPerSecond = ns > 0 ? (float)(iterations / (ns * 1e-9)) : 0;
+
+            uint32_t histogram[2 + IterationStats::Bins];
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, slot.histogram);
+            glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(histogram), histogram);
+            m_lastStats = IterationStats(slot.iter);
+            m_lastStats.pixels = (uint64_t)slot.width * slot.height;
+            m_lastStats.total = iterations;
+            m_lastStats.bounded = histogram[0];
+            m_lastStats.maxEscape = histogram[1];
+            for(int b = 0; b < IterationStats::Bins; b++)
+                m_lastStats.histogram[b] = histogram[2 + b];
+        }
+
+        if(m_log)
+            std::fprintf(m_log, "%llu,%.3f,%.4f,%.4f,%llu,%d,%d,%d,%.17g\n", (unsigned long long)slot.frame,
+                         glfwGetTime(), slot.frameMs, passMs, (unsigned long long)iterations, slot.width,
+                         slot.height, slot.iter, slot.zoom);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void PerfPanel::startLog()
+{
+    m_log = std::fopen(m_logPath.c_str(), "w");
+    if(!m_log)
+    {
+        std::cerr << "[Perf]: Could not open " << m_logPath << std::endl;
+        m_logging = false;
+        return;
+    }
+    std::fprintf(m_log, "frame,time_s,frame_ms,pass_ms,iterations,width,height,iter,zoom\n");
+}
+
+void PerfPanel::stopLog()
+{
+    if(m_log)
+        std::fclose(m_log);
+    m_log = nullptr;
+}
+
+void PerfPanel::draw(bool* open)
+{
+    ImGui::Begin("Performance", open);
+
+    if(!m_frameMs.empty())
+    {
+        float mean = m_frameMs.mean();
+        ImGui::Text("Frame   %6.2f ms  (%.0f FPS)", mean, mean > 0 ? 1000.0f / mean : 0.0f);
+        ImGui::Text("        p50 %6.2f  p95 %6.2f  p99 %6.2f ms", m_frameMs.percentile(0.5f),
+                    m_frameMs.percentile(0.95f), m_frameMs.percentile(0.99f));
+        std::vector<float> frames = m_frameMs.values();
+        ImGui::PlotLines("##frames", frames.data(), (int)frames.size(), 0, nullptr, 0.0f, FLT_MAX, ImVec2(0, 50));
+    }
+    if(!m_passMs.empty())
+    {
+        ImGui::Text("Fractal %6.2f ms on the GPU", m_passMs.mean());
+        ImGui::Text("        p50 %6.2f  p95 %6.2f  p99 %6.2f ms", m_passMs.percentile(0.5f),
+                    m_passMs.percentile(0.95f), m_passMs.percentile(0.99f));
+        std::vector<float> passes = m_passMs.values();
+        ImGui::PlotLines("##passes", passes.data(), (int)passes.size(), 0, nullptr, 0.0f, FLT_MAX, ImVec2(0, 50));
+    }
+
+    // A few atomics per pixel, so counting makes the pass itself slower
+    ImGui::Checkbox("Iteration statistics", &m_countIterations);
+    if(m_countIterations && !m_iterations.empty())
+    {
+        const IterationStats& s = m_lastStats;
+        ImGui::Text("%.3f Giter/frame  %.2f Giter/s", m_iterations.mean() * 1e-9f, m_lastIterationsPerSecond * 1e-9f);
+        ImGui::Text("%.2f%% of pixels reach iter %d", s.boundedFraction() * 100, s.iter);
+        ImGui::Text("Escapes after %.1f iterations on average, %u at most", s.meanEscape(), s.maxEscape);
+
+        float bins[IterationStats::Bins];
+        for(int b = 0; b < IterationStats::Bins; b++)
+            bins[b] = (float)s.histogram[b];
+        ImGui::PlotHistogram("##escapes", bins, IterationStats::Bins, 0, "escape iteration (0 .. iter)",
+                             0.0f, FLT_MAX, ImVec2(0, 80));
+    }
+
+    if(ImGui::Checkbox("Log to frametimes.csv", &m_logging))
+    {
+        if(m_logging)
+            startLog();
+        else
+            stopLog();
+    }
+
+    ImGui::End();
+}
@@ -0,0 +1,90 @@
+#ifndef MANDELBROTSET_PERFPANEL_H
+#define MANDELBROTSET_PERFPANEL_H
+
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <string>
+#include <vector>
+#include "iterstats.h"
+
+// Values of the last `capacity` frames with percentiles
+class SlidingWindow
+{
+public:
+    explicit SlidingWindow(size_t capacity) : m_capacity(capacity) {}
+
+    void push(float value);
+    bool empty() const { return m_values.empty(); }
+    // p in [0, 1]
+    float percentile(float p) const;
+    float mean() const;
+    // Oldest first, for ImGui::PlotLines
+    std::vector<float> values() const { return std::vector<float>(m_values.begin(), m_values.end()); }
+
+private:
+    size_t m_capacity;
+    std::deque<float> m_values;
+};
+
+// Frame time statistics of the window. The fractal pass is timed on the GPU with
+// GL_TIME_ELAPSED queries, and the shader can reduce the iteration counts of the
+// frame into storage buffers (total, histogram, bounded pixels, highest escape).
+// Results are read a few frames later, once the GPU is done with them, so
+// measuring never stalls the pipeline. Needs a current GL 4.4 context.
+class PerfPanel
+{
+public:
+    PerfPanel();
+    ~PerfPanel();
+
+    void init();
+    void beginFrame();
+    // Bracket the fractal draw call. Binds the iteration counter and histogram to
+    // storage buffer bindings 0 and 1.
+    void beginFractalPass();
+    void endFractalPass();
+    void endFrame(int width, int height, int iter, double zoom);
+
+    // Whether the shader should count iterations this frame
+    bool countIterations() const { return m_countIterations; }
+
+    void draw(bool* open);
+
+private:
+    // Results of one in-flight frame
+    struct Slot
+    {
+        uint32_t query = 0;
+        uint32_t counter = 0;
+        uint32_t histogram = 0;
+        bool pending = false;
+        bool counted = false;
+        uint64_t frame = 0;
+        int width = 0, height = 0, iter = 0;
+        double zoom = 0;
+        float frameMs = 0;
+    };
+    static const int Slots = 4;
+
+    void collect();
+    void startLog();
+    void stopLog();
+
+    Slot m_slots[Slots];
+    int m_current = 0;
+    uint64_t m_frame = 0;
+    double m_lastFrameStart = 0;
+    float m_lastFrameMs = 0;
+
+    SlidingWindow m_frameMs, m_passMs, m_iterations;
+    float m_lastIterationsPerSecond = 0;
+    IterationStats m_lastStats;
+
+    bool m_countIterations = false;
+    bool m_logging = false;
+    std::string m_logPath = "frametimes.csv";
+    FILE* m_log = nullptr;
+};
+
+#endif //MANDELBROTSET_PERFPANEL_H
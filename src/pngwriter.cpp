@@ -0,0 +1,218 @@
+#include "imagewriter.h"
+#include "deflate.h"
+#include "threadpool.h"
+#include "fileutil.h"
+#include "profiler.h"
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+
+namespace
+{
+    // Size of the row blocks deflated as separate streams. It does not depend on the
+    // thread count, so the output is identical however many threads encode it.
+    const size_t BlockBytes = 128 * 1024;
+
+    void PutU32(uint8_t* p, uint32_t v)
+    {
+        p[0] = uint8_t(v >> 24);
+        p[1] = uint8_t(v >> 16);
+        p[2] = uint8_t(v >> 8);
+        p[3] = uint8_t(v);
+    }
+
+    int Paeth(int a, int b, int c)
+    {
+        int p = a + b - c;
+        int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+        if(pa <= pb && pa <= pc) return a;
+        if(pb <= pc) return b;
+        return c;
+    }
+
+    // Applies the filter with the smallest sum of absolute differences (the libpng heuristic).
+    // `out` receives the filter type byte followed by the filtered row.
+    void FilterRow(const uint8_t* row, const uint8_t* prev, int bytes, int bpp, uint8_t* out, uint8_t* tmp)
+    {
+        unsigned best = ~0u;
+        for(int type = 0; type < 5; type++)
+        {
+            unsigned sum = 0;
+            for(int i = 0; i < bytes; i++)
+            {
+                int a = i >= bpp ? row[i - bpp] : 0;
+                int b = prev ? prev[i] : 0;
+                int c = prev && i >= bpp ? prev[i - bpp] : 0;
+                int v = row[i];
+                switch(type)
+                {
+                    case 1: v -= a; break;
+                    case 2: v -= b; break;
+                    case 3: v -= (a + b) / 2; break;
+                    case 4: v -= Paeth(a, b, c); break;
+                    default: break;
+                }
+                tmp[i] = (uint8_t)v;
+                sum += std::abs((int)(int8_t)tmp[i]);
+            }
+            if(sum < best)
+            {
+                best = sum;
+                out[0] = (uint8_t)type;
+                std::copy(tmp, tmp + bytes, out + 1);
+            }
+        }
+    }
+
+    void AppendChunk(std::vector<uint8_t>& out, const char* type, const uint8_t* data, size_t size)
+    {
+        size_t start = out.size();
+        out.resize(start + 12 + size);
+        uint8_t* p = &out[start];
+        PutU32(p, (uint32_t)size);
+        std::copy(type, type + 4, p + 4);
+        std::copy(data, data + size, p + 8);
+        PutU32(p + 8 + size, Deflate::Crc32(0, p + 4, size + 4));
+    }
+}
+
+PNGWriter::PNGWriter(const std::string& path, int width, int height, unsigned threads, const WriterCheckpoint* resume)
+    :ImageWriter(width, height)
+{
+    // A single-threaded writer encodes inline, which keeps per-tile writers cheap
+    if(threads != 1)
+        m_pool.reset(new ThreadPool(threads));
+
+    // Every batch of rows ends on a chunk boundary with a byte aligned deflate stream,
+    // so the file can be cut there and continued
+    if(resume)
+    {
+        m_file = ReopenTruncated(path, resume->fileSize);
+        if(!m_file)
+            throw std::runtime_error("[PNG]: Could not resume " + path);
+        m_rowsWritten = resume->rows;
+        m_adler = resume->adler;
+        m_prevRow = resume->prevRow;
+        return;
+    }
+
+    m_file = std::fopen(path.c_str(), "wb");
+    if(!m_file)
+        throw std::runtime_error("[PNG]: Could not open " + path + " for writing");
+
+    static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    std::fwrite(signature, 1, 8, m_file);
+
+    uint8_t ihdr[13] = {0};
+    PutU32(ihdr, (uint32_t)width);
+    PutU32(ihdr + 4, (uint32_t)height);
+    ihdr[8] = 8;  // bit depth
+    ihdr[9] = 2;  // truecolor
+    writeChunk("IHDR", ihdr, sizeof(ihdr));
+
+    // zlib header in its own IDAT, the row blocks follow as raw deflate data
+    static const uint8_t zlibHeader[2] = {0x78, 0x9C};
+    writeChunk("IDAT", zlibHeader, 2);
+}
+
+PNGWriter::~PNGWriter()
+{
+    if(m_file)
+        std::fclose(m_file);
+}
+
+void PNGWriter::writeChunk(const char* type, const uint8_t* data, size_t size)
+{
+    std::vector<uint8_t> chunk;
+    AppendChunk(chunk, type, data, size);
+    if(std::fwrite(chunk.data(), 1, chunk.size(), m_file) != chunk.size())
+        throw std::runtime_error("[PNG]: Write failed");
+}
+
+void PNGWriter::writeRows(const uint8_t* rgb, int rows)
+{
+    if(rows <= 0)
+        return;
+    if(m_rowsWritten + rows > m_height)
+        throw std::runtime_error("[PNG]: Too many rows written");
+
+    const size_t rowBytes = (size_t)m_width * 3;
+    const int blockRows = (int)std::min<size_t>(rows, (BlockBytes + rowBytes - 1) / rowBytes);
+    const int blocks = (rows + blockRows - 1) / blockRows;
+
+    struct Block
+    {
+        std::vector<uint8_t> chunk;
+        uint32_t adler;
+        size_t size;
+    };
+    std::vector<Block> out(blocks);
+    const uint8_t* firstPrev = m_prevRow.empty() ? nullptr : m_prevRow.data();
+
+    auto encode = [&](int b, unsigned)
+    {
+        PROFILE_SCOPE("deflate block");
+        const int r0 = b * blockRows;
+        const int n = std::min(blockRows, rows - r0);
+        std::vector<uint8_t> filtered((rowBytes + 1) * n);
+        std::vector<uint8_t> tmp(rowBytes);
+        for(int r = 0; r < n; r++)
+        {
+            const uint8_t* row = rgb + (r0 + r) * rowBytes;
+            const uint8_t* prev = r0 + r > 0 ? row - rowBytes : firstPrev;
+            FilterRow(row, prev, (int)rowBytes, 3, &filtered[r * (rowBytes + 1)], tmp.data());
+        }
+
+        std::vector<uint8_t> compressed;
+        Deflate::Compress(filtered.data(), filtered.size(), false, compressed);
+        AppendChunk(out[b].chunk, "IDAT", compressed.data(), compressed.size());
+        out[b].adler = Deflate::Adler32(1, filtered.data(), filtered.size());
+        out[b].size = filtered.size();
+    };
+    if(m_pool)
+        m_pool->parallelFor(blocks, encode);
+    else
+        for(int b = 0; b < blocks; b++)
+            encode(b, 0);
+
+    PROFILE_SCOPE("write IDAT");
+    for(const Block& block : out)
+    {
+        if(std::fwrite(block.chunk.data(), 1, block.chunk.size(), m_file) != block.chunk.size())
+            throw std::runtime_error("[PNG]: Write failed");
+        m_adler = Deflate::Adler32Combine(m_adler, block.adler, block.size);
+    }
+
+    m_prevRow.assign(rgb + (rows - 1) * rowBytes, rgb + rows * rowBytes);
+    m_rowsWritten += rows;
+}
+
+WriterCheckpoint PNGWriter::checkpoint()
+{
+    SyncFile(m_file);
+    WriterCheckpoint state;
+    state.fileSize = FilePosition(m_file);
+    state.rows = m_rowsWritten;
+    state.adler = m_adler;
+    state.prevRow = m_prevRow;
+    return state;
+}
+
+void PNGWriter::finish()
+{
+    if(m_rowsWritten != m_height)
+        throw std::runtime_error("[PNG]: Image is incomplete");
+
+    std::vector<uint8_t> tail;
+    Deflate::FinalBlock(tail);
+    uint8_t adler[4];
+    PutU32(adler, m_adler);
+    tail.insert(tail.end(), adler, adler + 4);
+    writeChunk("IDAT", tail.data(), tail.size());
+    writeChunk("IEND", nullptr, 0);
+
+    int err = std::fclose(m_file);
+    m_file = nullptr;
+    if(err != 0)
+        throw std::runtime_error("[PNG]: Write failed");
+}
@@ -0,0 +1,202 @@
+#include "poster.h"
+#include "palette.h"
+#include "threadpool.h"
+#include "imagewriter.h"
+#include "fileutil.h"
+#include "profiler.h"
+#include "heatmap.h"
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace
+{
+    const char* CheckpointMagic = "MandelbrotSet poster checkpoint 1";
+
+    // Everything that influences the bytes of the output file
+    std::string JobDescription(const PosterJob& job)
+    {
+        std::ostringstream ss;
+        ss << std::setprecision(17)
+           << job.params.iter << " " << job.params.zoom << " " << job.params.OffX << " " << job.params.OffY << " "
+           << job.params.freq << " " << job.params.UVoffset << " " << job.width << " " << job.height << " "
+           << job.viewWidth << " " << job.stripHeight << " " << job.palette << " " << job.output;
+        return ss.str();
+    }
+
+    void SaveCheckpoint(const std::string& path, const std::string& description, int strips,
+                        const WriterCheckpoint& state)
+    {
+        std::string part = path + ".part";
+        {
+            std::ofstream out(part, std::ios::binary | std::ios::trunc);
+            out << CheckpointMagic << "\n" << description << "\n" << strips << " " << state.fileSize << " "
+                << state.rows << " " << state.adler << " " << state.prevRow.size() << "\n";
+            out.write((const char*)state.prevRow.data(), (std::streamsize)state.prevRow.size());
+            if(!out)
+                throw std::runtime_error("[Poster]: Could not write checkpoint " + part);
+        }
+        RenameFile(part, path);
+    }
+
+    bool LoadCheckpoint(const std::string& path, const std::string& description, int& strips,
+                        WriterCheckpoint& state)
+    {
+        std::ifstream in(path, std::ios::binary);
+        std::string magic, saved;
+        size_t prevRowSize = 0;
+        std::getline(in, magic);
+        std::getline(in, saved);
+        in >> strips >> state.fileSize >> state.rows >> state.adler >> prevRowSize;
+        in.get();
+        state.prevRow.resize(prevRowSize);
+        in.read((char*)state.prevRow.data(), (std::streamsize)prevRowSize);
+        if(!in || magic != CheckpointMagic)
+            throw std::runtime_error("[Poster]: Checkpoint " + path + " is damaged");
+        return saved == description;
+    }
+}
+
+void RenderPoster(const PosterJob& job)
+{
+    if(job.width <= 0 || job.height <= 0 || job.stripHeight <= 0 || job.tileWidth <= 0 || job.tileHeight <= 0)
+        throw std::runtime_error("[Poster]: Invalid job dimensions");
+    const Fractal::KernelInfo* kernel = Fractal::FindKernel(job.kernel);
+    if(!kernel)
+        throw std::runtime_error("[Poster]: Unknown kernel " + job.kernel);
+
+    typedef std::chrono::steady_clock Clock;
+
+    // Keep the framing of the window the parameters were saved from
+    FractalParams params = job.params;
+    params.zoom *= (double)job.width / job.viewWidth;
+
+    Palette palette(job.palette.c_str());
+    ThreadPool pool(job.threads);
+    const int strips = (job.height + job.stripHeight - 1) / job.stripHeight;
+    const std::string checkpointPath = job.checkpoint.empty() ? job.output + ".ckpt" : job.checkpoint;
+    const std::string description = JobDescription(job);
+
+    int firstStrip = 0;
+    WriterCheckpoint resume;
+    if(!job.restart && FileExists(checkpointPath))
+    {
+        if(!LoadCheckpoint(checkpointPath, description, firstStrip, resume))
+            throw std::runtime_error("[Poster]: " + checkpointPath + " belongs to a different job, use --restart to discard it");
+        std::cout << "[Poster]: resuming after strip " << firstStrip << " of " << strips << std::endl;
+    }
+    std::unique_ptr<ImageWriter> writer = CreateImageWriter(job.output, job.width, job.height, job.threads,
+                                                            firstStrip > 0 ? &resume : nullptr);
+
+    // Tiles split the strips evenly so that they line up across strips in the heatmap
+    const int tileHeight = job.stripHeight % job.tileHeight == 0 ? job.tileHeight : job.stripHeight;
+    const int tilesX = (job.width + job.tileWidth - 1) / job.tileWidth;
+    const int tilesPerStrip = tilesX * (job.stripHeight / tileHeight);
+    const size_t stripBytes = (size_t)job.width * 3 * job.stripHeight;
+
+    // Strip k is rendered into one buffer while strip k-1 is encoded from the other
+    std::vector<uint8_t> buffers[2] = { std::vector<uint8_t>(stripBytes), std::vector<uint8_t>(stripBytes) };
+    std::vector<std::vector<uint32_t>> scratch(pool.size(), std::vector<uint32_t>((size_t)job.tileWidth * tileHeight));
+    std::vector<uint64_t> iterations(pool.size(), 0);
+    std::unique_ptr<TileCostMap> tileTime, tileIterations;
+    if(job.heatmap)
+    {
+        tileTime.reset(new TileCostMap(job.width, job.height, job.tileWidth, tileHeight));
+        tileIterations.reset(new TileCostMap(job.width, job.height, job.tileWidth, tileHeight));
+    }
+
+    std::cout << "[Poster]: " << job.width << "x" << job.height << " in " << strips << " strips on "
+              << pool.size() << " threads -> " << job.output << std::endl;
+
+    Clock::time_point start = Clock::now(), lastReport = start, lastCheckpoint = start;
+    for(int s = firstStrip; s <= strips; s++)
+    {
+        if(s < strips)
+        {
+            const int y0 = s * job.stripHeight;
+            const int rows = std::min(job.stripHeight, job.height - y0);
+            uint8_t* strip = buffers[s % 2].data();
+            for(int t = 0; t < tilesPerStrip; t++)
+            {
+                const int ty = y0 + (t / tilesX) * tileHeight;
+                if(ty >= y0 + rows)
+                    break;
+                pool.submit([&, t, ty, y0, rows, strip](unsigned worker)
+                {
+                    PROFILE_SCOPE("tile");
+                    const int x0 = (t % tilesX) * job.tileWidth;
+                    const int w = std::min(job.tileWidth, job.width - x0);
+                    const int h = std::min(tileHeight, y0 + rows - ty);
+                    uint32_t* iters = scratch[worker].data();
+                    Clock::time_point tileStart = Clock::now();
+                    uint64_t n = kernel->render(params, job.width, job.height, x0, ty, w, h, iters, w);
+                    iterations[worker] += n;
+                    if(tileTime)
+                    {
+                        tileTime->add(t % tilesX, ty / tileHeight,
+                                      std::chrono::duration<double>(Clock::now() - tileStart).count());
+                        tileIterations->add(t % tilesX, ty / tileHeight, (double)n);
+                    }
+                    for(int j = 0; j < h; j++)
+                        palette.colorize(iters + (size_t)j * w, w, params.iter, params.freq, params.UVoffset,
+                                         strip + ((size_t)(ty - y0 + j) * job.width + x0) * 3);
+                });
+            }
+        }
+
+        if(s > firstStrip)
+        {
+            PROFILE_SCOPE("write strip");
+            const int y0 = (s - 1) * job.stripHeight;
+            writer->writeRows(buffers[(s - 1) % 2].data(), std::min(job.stripHeight, job.height - y0));
+
+            if(job.checkpointInterval > 0 && s < strips
+               && Clock::now() - lastCheckpoint >= std::chrono::seconds(job.checkpointInterval))
+            {
+                PROFILE_SCOPE("checkpoint");
+                SaveCheckpoint(checkpointPath, description, s, writer->checkpoint());
+                lastCheckpoint = Clock::now();
+            }
+        }
+
+        pool.wait();
+
+        Clock::time_point now = Clock::now();
+        if(s < strips && now - lastReport > std::chrono::seconds(1))
+        {
+            double elapsed = std::chrono::duration<double>(now - start).count();
+            double done = (double)(s + 1 - firstStrip) / (strips - firstStrip);
+            double pixels = (double)job.width * (std::min((s + 1) * job.stripHeight, job.height) - firstStrip * job.stripHeight);
+            std::printf("\r[Poster]: %5.1f%%  %8.2f Mpix/s  ETA %.0fs   ", 100.0 * (s + 1) / strips,
+                        pixels / elapsed * 1e-6, elapsed / done - elapsed);
+            std::fflush(stdout);
+            lastReport = now;
+        }
+    }
+    writer->finish();
+    std::remove(checkpointPath.c_str());
+
+    uint64_t total = 0;
+    for(uint64_t n : iterations)
+        total += n;
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    double pixels = (double)job.width * (job.height - std::min(job.height, firstStrip * job.stripHeight));
+    std::printf("\r[Poster]: done in %.2fs  %.2f Mpix/s  %.3f Giter/s\n", elapsed, pixels / elapsed * 1e-6,
+                total / elapsed * 1e-9);
+
+    if(tileTime)
+    {
+        // Tiles of strips restored from a checkpoint were not measured and stay cold
+        const std::string timePath = HeatmapPath(job.output, "time"), iterPath = HeatmapPath(job.output, "iterations");
+        tileTime->writeImage(timePath);
+        tileIterations->writeImage(iterPath);
+        std::printf("[Poster]: slowest tile %.2fms, %.1fx the mean -> %s, %s\n", tileTime->max() * 1e3,
+                    tileTime->mean() > 0 ? tileTime->max() / tileTime->mean() : 0.0, timePath.c_str(), iterPath.c_str());
+    }
+}
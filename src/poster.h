@@ -0,0 +1,36 @@
+#ifndef MANDELBROTSET_POSTER_H
+#define MANDELBROTSET_POSTER_H
+
+#include <string>
+#include "fractal.h"
+
+// A large still image rendered in horizontal strips and streamed to disk
+struct PosterJob
+{
+    FractalParams params;
+    int width = 8000, height = 8000;
+    int viewWidth = 800;    // width of the window the params were taken from
+    int stripHeight = 64;   // part of the output bytes and of the checkpoint, so never tuned
+    int tileWidth = 256;
+    int tileHeight = 64;    // a divisor of stripHeight, otherwise tiles span the whole strip
+    unsigned threads = 0;   // 0 = all hardware threads
+    std::string kernel = "scalar";  // see Fractal::Kernels
+    std::string palette = "img/pal.png";
+    std::string output = "poster.png";
+
+    // Periodically the output is flushed and the encoder state saved, so that a
+    // rerun of the same job continues after the last saved strip
+    std::string checkpoint;     // default: output + ".ckpt"
+    int checkpointInterval = 30;// seconds, 0 disables checkpoints
+    bool restart = false;       // ignore an existing checkpoint
+
+    // Also write the compute time and iterations of every tile as heatmap images
+    // next to the output (poster.time.png, poster.iterations.png)
+    bool heatmap = false;
+};
+
+// Renders the poster with memory bounded by two strips, independent of the image height.
+// A resumed render produces a file identical to an uninterrupted one.
+void RenderPoster(const PosterJob& job);
+
+#endif //MANDELBROTSET_POSTER_H
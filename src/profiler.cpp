@@ -0,0 +1,169 @@
+#include "profiler.h"
+#include <atomic>
+#include <cstdio>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+    struct Event
+    {
+        const char* name;
+        uint64_t start, end;    // nanoseconds since the profiler epoch
+    };
+
+    // Written only by its thread; `count` is published after every event so the
+    // exporter can read while the owner keeps recording
+    struct ThreadBuffer
+    {
+        static const size_t Capacity = 1 << 15;   // power of two
+
+        int id;
+        std::string name;
+        std::vector<Event> events;
+        std::atomic<uint64_t> count;
+
+        explicit ThreadBuffer(int id) : id(id), events(Capacity), count(0) {}
+    };
+
+    struct Registry
+    {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+        std::vector<ThreadBuffer*> unused;      // of threads that exited, handed to new threads
+        std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+    };
+
+    Registry& GetRegistry()
+    {
+        static Registry registry;
+        return registry;
+    }
+
+    uint64_t Now()
+    {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - GetRegistry().epoch).count();
+    }
+
+    // Thread pools come and go (the benchmark creates one per thread count), so the
+    // buffers of finished threads are reused instead of growing memory per thread
+    struct ThreadSlot
+    {
+        ThreadBuffer* buffer = nullptr;
+
+        ThreadBuffer* get()
+        {
+            if(!buffer)
+            {
+                Registry& registry = GetRegistry();
+                std::lock_guard<std::mutex> lock(registry.mutex);
+                if(!registry.unused.empty())
+                {
+                    buffer = registry.unused.back();
+                    registry.unused.pop_back();
+                }
+                else
+                {
+                    registry.buffers.emplace_back(new ThreadBuffer((int)registry.buffers.size() + 1));
+                    buffer = registry.buffers.back().get();
+                }
+            }
+            return buffer;
+        }
+
+        ~ThreadSlot()
+        {
+            if(!buffer)
+                return;
+            Registry& registry = GetRegistry();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            registry.unused.push_back(buffer);
+        }
+    };
+
+    thread_local ThreadSlot t_slot;
+
+    void WriteEscaped(std::ostream& out, const std::string& text)
+    {
+        for(char c : text)
+        {
+            if(c == '"' || c == '\\')
+                out << '\\';
+            out << c;
+        }
+    }
+}
+
+bool Profiler::Enabled()
+{
+#ifdef MANDELBROT_PROFILE
+    return true;
+#else
+    return false;
+#endif
+}
+
+void Profiler::SetThreadName(const std::string& name)
+{
+    ThreadBuffer* buffer = t_slot.get();
+    std::lock_guard<std::mutex> lock(GetRegistry().mutex);
+    buffer->name = name;
+}
+
+Profiler::Zone::Zone(const char* name)
+    : m_name(name), m_start(Now())
+{
+}
+
+Profiler::Zone::~Zone()
+{
+    ThreadBuffer* buffer = t_slot.get();
+    uint64_t n = buffer->count.load(std::memory_order_relaxed);
+    Event& e = buffer->events[n & (ThreadBuffer::Capacity - 1)];
+    e.name = m_name;
+    e.start = m_start;
+    e.end = Now();
+    buffer->count.store(n + 1, std::memory_order_release);
+}
+
+bool Profiler::WriteChromeTrace(const std::string& path)
+{
+    std::ofstream out(path, std::ios::trunc);
+    if(!out.is_open())
+        return false;
+
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    const char* separator = "\n";
+    for(const std::unique_ptr<ThreadBuffer>& buffer : registry.buffers)
+    {
+        std::string name = buffer->name.empty() ? "thread " + std::to_string(buffer->id) : buffer->name;
+        out << separator << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << buffer->id
+            << ",\"args\":{\"name\":\"";
+        WriteEscaped(out, name);
+        out << "\"}}";
+        separator = ",\n";
+
+        // Only the newest Capacity events survive; the oldest slot may be mid-write
+        uint64_t count = buffer->count.load(std::memory_order_acquire);
+        uint64_t first = count > ThreadBuffer::Capacity ? count - ThreadBuffer::Capacity + 1 : 0;
+        for(uint64_t i = first; i < count; i++)
+        {
+            const Event& e = buffer->events[i & (ThreadBuffer::Capacity - 1)];
+            char line[256];
+            std::snprintf(line, sizeof(line), ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"name\":\"",
+                          buffer->id, e.start * 1e-3, (e.end - e.start) * 1e-3);
+            out << line;
+            WriteEscaped(out, e.name);
+            out << "\"}";
+        }
+    }
+    out << "\n]}\n";
+    return (bool)out;
+}
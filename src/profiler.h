@@ -0,0 +1,48 @@
+#ifndef MANDELBROTSET_PROFILER_H
+#define MANDELBROTSET_PROFILER_H
+
+#include <cstdint>
+#include <string>
+
+// Timeline profiler. PROFILE_SCOPE("name") records the time spent in the
+// enclosing scope as an event of the current thread; events go to a per-thread
+// ring buffer (the newest ones are kept) and can be exported as Chrome trace
+// JSON, viewable in chrome://tracing or ui.perfetto.dev. The macros compile to
+// nothing unless MANDELBROT_PROFILE is defined (CMake option of the same name).
+// Names must be string literals, only their address is stored.
+namespace Profiler
+{
+    // False when built without MANDELBROT_PROFILE
+    bool Enabled();
+
+    // Label of the calling thread's track in the trace
+    void SetThreadName(const std::string& name);
+
+    // Writes every recorded event. Returns false if nothing could be written.
+    bool WriteChromeTrace(const std::string& path);
+
+    class Zone
+    {
+    public:
+        explicit Zone(const char* name);
+        ~Zone();
+        Zone(const Zone&) = delete;
+        Zone& operator=(const Zone&) = delete;
+
+    private:
+        const char* m_name;
+        uint64_t m_start;
+    };
+}
+
+#ifdef MANDELBROT_PROFILE
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(name) Profiler::Zone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_THREAD_NAME(name) Profiler::SetThreadName(name)
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_THREAD_NAME(name) ((void)0)
+#endif
+
+#endif //MANDELBROTSET_PROFILER_H
@@ -0,0 +1,273 @@
+#include "pyramid.h"
+#include "palette.h"
+#include "threadpool.h"
+#include "imagewriter.h"
+#include "fileutil.h"
+#include "profiler.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+    struct Level
+    {
+        int width, height, cols, rows;
+    };
+
+    struct Rect
+    {
+        int x0, y0, x1, y1;
+        int width() const { return x1 - x0; }
+        int height() const { return y1 - y0; }
+    };
+
+    class Pyramid
+    {
+    public:
+        explicit Pyramid(const PyramidJob& job) : m_job(job)
+        {
+            int size = std::max(job.width, job.height);
+            int limit = job.layout == PyramidJob::DZI ? 1 : job.tileSize;
+            m_maxLevel = 0;
+            while(((size - 1) >> m_maxLevel) + 1 > limit)
+                m_maxLevel++;
+
+            for(int l = 0; l <= m_maxLevel; l++)
+            {
+                int shift = m_maxLevel - l;
+                Level level;
+                level.width = ((job.width - 1) >> shift) + 1;
+                level.height = ((job.height - 1) >> shift) + 1;
+                level.cols = (level.width + job.tileSize - 1) / job.tileSize;
+                level.rows = (level.height + job.tileSize - 1) / job.tileSize;
+                m_levels.push_back(level);
+            }
+
+            m_root = job.layout == PyramidJob::DZI ? job.output + "_files" : job.output;
+        }
+
+        int maxLevel() const { return m_maxLevel; }
+        const Level& level(int l) const { return m_levels[l]; }
+        const std::string& root() const { return m_root; }
+
+        std::string levelDir(int l, int col) const
+        {
+            std::ostringstream ss;
+            ss << m_root << "/" << l;
+            if(m_job.layout == PyramidJob::XYZ)
+                ss << "/" << col;
+            return ss.str();
+        }
+
+        std::string tilePath(int l, int col, int row) const
+        {
+            std::ostringstream ss;
+            if(m_job.layout == PyramidJob::DZI)
+                ss << levelDir(l, col) << "/" << col << "_" << row << ".png";
+            else
+                ss << levelDir(l, col) << "/" << row << ".png";
+            return ss.str();
+        }
+
+        // Area covered by a tile file, overlap included
+        Rect tileRect(int l, int col, int row) const
+        {
+            const Level& level = m_levels[l];
+            const int T = m_job.tileSize, ov = m_job.overlap;
+            Rect r;
+            r.x0 = std::max(0, col * T - ov);
+            r.y0 = std::max(0, row * T - ov);
+            r.x1 = std::min(level.width, (col + 1) * T + ov);
+            r.y1 = std::min(level.height, (row + 1) * T + ov);
+            return r;
+        }
+
+        // Gathers an area of level `l` from the tiles already written for it
+        void readRegion(int l, const Rect& area, std::vector<uint8_t>& rgb) const
+        {
+            const int T = m_job.tileSize;
+            rgb.assign((size_t)area.width() * area.height() * 3, 0);
+            std::vector<uint8_t> tile;
+            for(int row = area.y0 / T; row <= (area.y1 - 1) / T; row++)
+                for(int col = area.x0 / T; col <= (area.x1 - 1) / T; col++)
+                {
+                    std::string path = tilePath(l, col, row);
+                    int w, h;
+                    if(!LoadImageRGB(path, w, h, tile))
+                        throw std::runtime_error("[Pyramid]: Could not read tile " + path
+                                                 + ", delete it to render it again");
+                    Rect file = tileRect(l, col, row);
+                    int x0 = std::max(area.x0, col * T), x1 = std::min(area.x1, (col + 1) * T);
+                    int y0 = std::max(area.y0, row * T), y1 = std::min(area.y1, (row + 1) * T);
+                    x1 = std::min(x1, file.x0 + w);
+                    y1 = std::min(y1, file.y0 + h);
+                    for(int y = y0; y < y1; y++)
+                        std::copy(&tile[((size_t)(y - file.y0) * w + (x0 - file.x0)) * 3],
+                                  &tile[((size_t)(y - file.y0) * w + (x1 - file.x0)) * 3],
+                                  &rgb[((size_t)(y - area.y0) * area.width() + (x0 - area.x0)) * 3]);
+                }
+        }
+
+    private:
+        const PyramidJob& m_job;
+        int m_maxLevel;
+        std::vector<Level> m_levels;
+        std::string m_root;
+    };
+
+    std::string JobDescription(const PyramidJob& job)
+    {
+        std::ostringstream ss;
+        ss << std::setprecision(17)
+           << job.params.iter << " " << job.params.zoom << " " << job.params.OffX << " " << job.params.OffY << " "
+           << job.params.freq << " " << job.params.UVoffset << "\n"
+           << job.width << " " << job.height << " " << job.viewWidth << " " << job.tileSize << " " << job.overlap << "\n"
+           << job.palette << "\n";
+        return ss.str();
+    }
+
+    // Tiles are written under a temporary name so an interrupted run never leaves a truncated tile behind.
+    // Runs on the pool, whose parallelFor hands a failure (e.g. a full disk) back to ExportPyramid.
+    void WriteTile(const std::string& path, const Rect& r, const uint8_t* rgb)
+    {
+        std::string part = path.substr(0, path.size() - 4) + ".part.png";
+        try
+        {
+            WriteImage(part, r.width(), r.height(), rgb);
+            RenameFile(part, path);
+        }
+        catch(...)
+        {
+            std::remove(part.c_str());
+            throw;
+        }
+    }
+}
+
+void ExportPyramid(const PyramidJob& job)
+{
+    if(job.width <= 0 || job.height <= 0 || job.tileSize <= 0 || job.overlap < 0)
+        throw std::runtime_error("[Pyramid]: Invalid job dimensions");
+
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+
+    Pyramid pyramid(job);
+    Palette palette(job.palette.c_str());
+    ThreadPool pool(job.threads);
+
+    // A previous run of a different job must not be mixed with this one
+    MakeDirectories(pyramid.root());
+    std::string description = JobDescription(job);
+    std::string jobFile = pyramid.root() + "/job.txt";
+    if(FileExists(jobFile))
+    {
+        std::ifstream in(jobFile);
+        std::stringstream ss;
+        ss << in.rdbuf();
+        if(ss.str() != description)
+            throw std::runtime_error("[Pyramid]: " + pyramid.root() + " holds tiles of a different job");
+    }
+    else
+        std::ofstream(jobFile) << description;
+
+    FractalParams params = job.params;
+    params.zoom *= (double)job.width / job.viewWidth;
+
+    std::vector<std::vector<uint32_t>> scratch(pool.size());
+    std::atomic<int> computed(0), reused(0);
+
+    for(int l = pyramid.maxLevel(); l >= 0; l--)
+    {
+        const Level& level = pyramid.level(l);
+        for(int col = 0; col < level.cols; col++)
+            MakeDirectories(pyramid.levelDir(l, col));
+
+        pool.parallelFor(level.cols * level.rows, [&](int index, unsigned worker)
+        {
+            PROFILE_SCOPE("tile");
+            const int col = index % level.cols, row = index / level.cols;
+            std::string path = pyramid.tilePath(l, col, row);
+            if(FileExists(path))
+            {
+                reused++;
+                return;
+            }
+
+            Rect r = pyramid.tileRect(l, col, row);
+            std::vector<uint8_t> rgb((size_t)r.width() * r.height() * 3);
+            if(l == pyramid.maxLevel())
+            {
+                std::vector<uint32_t>& iters = scratch[worker];
+                iters.resize((size_t)r.width() * r.height());
+                Fractal::RenderIterations(params, job.width, job.height, r.x0, r.y0, r.width(), r.height(),
+                                          iters.data(), r.width());
+                palette.colorize(iters.data(), iters.size(), params.iter, params.freq, params.UVoffset, rgb.data());
+            }
+            else
+            {
+                // 2x2 box filter over the matching area of the finer level
+                const Level& fine = pyramid.level(l + 1);
+                Rect src = { r.x0 * 2, r.y0 * 2, std::min(r.x1 * 2, fine.width), std::min(r.y1 * 2, fine.height) };
+                std::vector<uint8_t> source;
+                pyramid.readRegion(l + 1, src, source);
+                for(int y = 0; y < r.height(); y++)
+                {
+                    int sy0 = 2 * y, sy1 = std::min(2 * y + 1, src.height() - 1);
+                    for(int x = 0; x < r.width(); x++)
+                    {
+                        int sx0 = 2 * x, sx1 = std::min(2 * x + 1, src.width() - 1);
+                        for(int c = 0; c < 3; c++)
+                        {
+                            int sum = source[((size_t)sy0 * src.width() + sx0) * 3 + c]
+                                    + source[((size_t)sy0 * src.width() + sx1) * 3 + c]
+                                    + source[((size_t)sy1 * src.width() + sx0) * 3 + c]
+                                    + source[((size_t)sy1 * src.width() + sx1) * 3 + c];
+                            rgb[((size_t)y * r.width() + x) * 3 + c] = (uint8_t)((sum + 2) / 4);
+                        }
+                    }
+                }
+            }
+            WriteTile(path, r, rgb.data());
+            computed++;
+        });
+
+        std::cout << "[Pyramid]: level " << l << " (" << level.width << "x" << level.height << ", "
+                  << level.cols * level.rows << " tiles) done" << std::endl;
+    }
+
+    if(job.layout == PyramidJob::DZI)
+    {
+        std::ofstream manifest(job.output + ".dzi");
+        manifest << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                 << "<Image xmlns=\"http://schemas.microsoft.com/deepzoom/2008\" Format=\"png\" Overlap=\""
+                 << job.overlap << "\" TileSize=\"" << job.tileSize << "\">\n"
+                 << "  <Size Width=\"" << job.width << "\" Height=\"" << job.height << "\"/>\n"
+                 << "</Image>\n";
+    }
+    else
+    {
+        std::ofstream manifest(job.output + "/tiles.json");
+        manifest << "{\n"
+                 << "  \"width\": " << job.width << ",\n"
+                 << "  \"height\": " << job.height << ",\n"
+                 << "  \"tileSize\": " << job.tileSize << ",\n"
+                 << "  \"overlap\": " << job.overlap << ",\n"
+                 << "  \"minZoom\": 0,\n"
+                 << "  \"maxZoom\": " << pyramid.maxLevel() << ",\n"
+                 << "  \"url\": \"{z}/{x}/{y}.png\"\n"
+                 << "}\n";
+    }
+
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    std::cout << "[Pyramid]: " << computed << " tiles written, " << reused << " reused in "
+              << elapsed << "s" << std::endl;
+}
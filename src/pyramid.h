@@ -0,0 +1,31 @@
+#ifndef MANDELBROTSET_PYRAMID_H
+#define MANDELBROTSET_PYRAMID_H
+
+#include <string>
+#include "fractal.h"
+
+// Tiled image pyramid for deep-zoom viewers. The finest level is rendered,
+// every coarser level is downsampled from the tiles of the level below.
+struct PyramidJob
+{
+    enum Layout
+    {
+        DZI = 0,    // <out>.dzi + <out>_files/<level>/<col>_<row>.png
+        XYZ = 1     // <out>/<z>/<x>/<y>.png + <out>/tiles.json
+    };
+
+    FractalParams params;
+    Layout layout = DZI;
+    int width = 16384, height = 16384;  // size of the finest level
+    int viewWidth = 800;
+    int tileSize = 254;
+    int overlap = 1;
+    unsigned threads = 0;
+    std::string palette = "img/pal.png";
+    std::string output = "pyramid";
+};
+
+// Tiles already present on disk from an interrupted run of the same job are reused
+void ExportPyramid(const PyramidJob& job);
+
+#endif //MANDELBROTSET_PYRAMID_H
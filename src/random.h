@@ -0,0 +1,25 @@
+#ifndef MANDELBROTSET_RANDOM_H
+#define MANDELBROTSET_RANDOM_H
+
+#include <cstdint>
+
+// splitmix64: tiny, fast and good enough for sampling. Seeding one generator per
+// unit of work keeps results independent of how the work is scheduled.
+struct Random
+{
+    uint64_t state;
+    explicit Random(uint64_t seed) : state(seed) {}
+
+    uint64_t next()
+    {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    // [0, 1)
+    double uniform() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+};
+
+#endif //MANDELBROTSET_RANDOM_H
@@ -0,0 +1,17 @@
+#include "settings.h"
+#include <fstream>
+
+bool LoadCustomSettings(const char* path, FractalParams& params)
+{
+    std::ifstream in(path);
+    if(!in.is_open())
+        return false;
+
+    FractalParams p;
+    in >> p.iter >> p.zoom >> p.OffX >> p.OffY >> p.freq >> p.UVoffset;
+    if(in.fail())
+        return false;
+
+    params = p;
+    return true;
+}
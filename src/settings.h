@@ -0,0 +1,6 @@
+#pragma once
+#include "fractal.h"
+
+// Reads a location saved in the settings.txt format:
+// iter, zoom, "OffX OffY", freq, UVoffset (one per line)
+bool LoadCustomSettings(const char* path, FractalParams& params);
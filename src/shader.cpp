@@ -1,8 +1,7 @@
 #include <GL/glew.h>
 #include "shader.h"
+#include "assets.h"
 #include <iostream>
-#include <fstream>
-#include <sstream>
 
 unsigned int Shader::CreateShader(Shader::ShaderType shaderType, const char* shaderPath)
 {
@@ -22,19 +21,11 @@ unsigned int Shader::CreateShader(Shader::ShaderType shaderType, const char* sha
     }
 
     std::string shaderSource;
-    std::ifstream in(shaderPath);
-    if(in.is_open())
+    if(!Assets::LoadShaderSource(shaderPath, shaderSource))
     {
-        std::stringstream ss;
-        ss << in.rdbuf();
-        shaderSource = ss.str();
-    }
-    else
-    {
-        std::cerr << "Warning: File " << shaderPath << " could not be opened!\n";
+        std::cerr << "Warning: File " << Assets::DiskPath(shaderPath) << " could not be opened!\n";
         return 0;
     }
-    in.close();
 
     const char* shaderSourcePointer = shaderSource.c_str();
     glShaderSource(shaderID, 1, &shaderSourcePointer, nullptr);
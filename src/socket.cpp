@@ -0,0 +1,234 @@
+#include "socket.h"
+#include <stdexcept>
+#include <vector>
+#include <cstring>
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef int socklen_t;
+#define SOCKET_WOULD_BLOCK (WSAGetLastError() == WSAEWOULDBLOCK)
+#define SOCKET_INTERRUPTED (WSAGetLastError() == WSAEINTR)
+#define poll WSAPoll
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#define SOCKET_WOULD_BLOCK (errno == EAGAIN || errno == EWOULDBLOCK)
+#define SOCKET_INTERRUPTED (errno == EINTR)
+#endif
+
+namespace
+{
+    void InitSockets()
+    {
+#ifdef _WIN32
+        static bool initialized = false;
+        if(!initialized)
+        {
+            WSADATA data;
+            if(WSAStartup(MAKEWORD(2, 2), &data) != 0)
+                throw std::runtime_error("[Socket]: Could not initialize Winsock");
+            initialized = true;
+        }
+#endif
+    }
+
+    void WaitWritable(Socket::Handle handle)
+    {
+        pollfd p;
+        p.fd = handle;
+        p.events = POLLOUT;
+        p.revents = 0;
+        poll(&p, 1, 1000);
+    }
+}
+
+Socket::~Socket()
+{
+    close();
+}
+
+Socket::Socket(Socket&& other) noexcept
+    :m_handle(other.m_handle)
+{
+    other.m_handle = Invalid;
+}
+
+Socket& Socket::operator=(Socket&& other) noexcept
+{
+    if(this != &other)
+    {
+        close();
+        m_handle = other.m_handle;
+        other.m_handle = Invalid;
+    }
+    return *this;
+}
+
+void Socket::close()
+{
+    if(!valid())
+        return;
+#ifdef _WIN32
+    closesocket(m_handle);
+#else
+    ::close(m_handle);
+#endif
+    m_handle = Invalid;
+}
+
+Socket Socket::Listen(const std::string& address, int port)
+{
+    InitSockets();
+    Socket s(::socket(AF_INET, SOCK_STREAM, 0));
+    if(!s.valid())
+        throw std::runtime_error("[Socket]: Could not create socket");
+
+    int yes = 1;
+    setsockopt(s.m_handle, SOL_SOCKET, SO_REUSEADDR, (const char*)&yes, sizeof(yes));
+
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((unsigned short)port);
+    if(inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1)
+        throw std::runtime_error("[Socket]: Invalid address " + address);
+    if(bind(s.m_handle, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(s.m_handle, 64) != 0)
+        throw std::runtime_error("[Socket]: Could not listen on " + address + ":" + std::to_string(port));
+    return s;
+}
+
+Socket Socket::Connect(const std::string& host, int port)
+{
+    InitSockets();
+    addrinfo hints, *result = nullptr;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    if(getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &result) != 0 || !result)
+        throw std::runtime_error("[Socket]: Could not resolve " + host);
+
+    Socket s(::socket(result->ai_family, result->ai_socktype, result->ai_protocol));
+    bool ok = s.valid() && ::connect(s.m_handle, result->ai_addr, (socklen_t)result->ai_addrlen) == 0;
+    freeaddrinfo(result);
+    if(!ok)
+        throw std::runtime_error("[Socket]: Could not connect to " + host + ":" + std::to_string(port));
+
+    int yes = 1;
+    setsockopt(s.m_handle, IPPROTO_TCP, TCP_NODELAY, (const char*)&yes, sizeof(yes));
+    return s;
+}
+
+Socket Socket::accept()
+{
+    Socket s(::accept(m_handle, nullptr, nullptr));
+    if(s.valid())
+    {
+        int yes = 1;
+        setsockopt(s.m_handle, IPPROTO_TCP, TCP_NODELAY, (const char*)&yes, sizeof(yes));
+    }
+    return s;
+}
+
+int Socket::port() const
+{
+    sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    if(getsockname(m_handle, (sockaddr*)&addr, &len) != 0)
+        return -1;
+    return ntohs(addr.sin_port);
+}
+
+void Socket::setNonBlocking(bool enable)
+{
+#ifdef _WIN32
+    u_long mode = enable ? 1 : 0;
+    ioctlsocket(m_handle, FIONBIO, &mode);
+#else
+    int flags = fcntl(m_handle, F_GETFL, 0);
+    fcntl(m_handle, F_SETFL, enable ? flags | O_NONBLOCK : flags & ~O_NONBLOCK);
+#endif
+}
+
+void Socket::sendAll(const void* data, size_t size)
+{
+    const char* p = (const char*)data;
+    while(size > 0)
+    {
+#ifdef _WIN32
+        long n = ::send(m_handle, p, (int)size, 0);
+#else
+        long n = ::send(m_handle, p, size, MSG_NOSIGNAL);
+#endif
+        if(n < 0 && SOCKET_WOULD_BLOCK)
+        {
+            WaitWritable(m_handle);
+            continue;
+        }
+        if(n < 0 && SOCKET_INTERRUPTED)
+            continue;
+        if(n <= 0)
+            throw std::runtime_error("[Socket]: Connection lost while sending");
+        p += n;
+        size -= (size_t)n;
+    }
+}
+
+bool Socket::recvAll(void* data, size_t size)
+{
+    char* p = (char*)data;
+    while(size > 0)
+    {
+        long n = recvSome(p, size);
+        if(n == 0)
+            return false;
+        if(n < 0)
+        {
+            Socket* self = this;
+            bool readable;
+            Poll(&self, 1, 1000, &readable);
+            continue;
+        }
+        p += n;
+        size -= (size_t)n;
+    }
+    return true;
+}
+
+long Socket::recvSome(void* data, size_t size)
+{
+    long n;
+    do
+    {
+#ifdef _WIN32
+        n = ::recv(m_handle, (char*)data, (int)size, 0);
+#else
+        n = ::recv(m_handle, data, size, 0);
+#endif
+    }
+    while(n < 0 && SOCKET_INTERRUPTED);  // a signal arrived before any data
+    if(n < 0 && SOCKET_WOULD_BLOCK)
+        return -1;
+    // errors are reported like a closed connection
+    return n < 0 ? 0 : n;
+}
+
+void Socket::Poll(Socket* const* sockets, size_t count, int timeoutMs, bool* readable)
+{
+    std::vector<pollfd> fds(count);
+    for(size_t i = 0; i < count; i++)
+    {
+        fds[i].fd = sockets[i]->m_handle;
+        fds[i].events = POLLIN;
+        fds[i].revents = 0;
+    }
+    poll(fds.data(), (unsigned long)count, timeoutMs);
+    for(size_t i = 0; i < count; i++)
+        readable[i] = (fds[i].revents & (POLLIN | POLLHUP | POLLERR)) != 0;
+}
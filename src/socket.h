@@ -0,0 +1,56 @@
+#ifndef MANDELBROTSET_SOCKET_H
+#define MANDELBROTSET_SOCKET_H
+
+#include <cstddef>
+#include <string>
+
+// Thin move-only wrapper over a TCP socket (BSD sockets / Winsock)
+class Socket
+{
+public:
+#ifdef _WIN32
+    typedef unsigned long long Handle;
+#else
+    typedef int Handle;
+#endif
+
+    Socket() = default;
+    ~Socket();
+    Socket(Socket&& other) noexcept;
+    Socket& operator=(Socket&& other) noexcept;
+    Socket(const Socket&) = delete;
+    Socket& operator=(const Socket&) = delete;
+
+    // port 0 picks a free port, see port()
+    static Socket Listen(const std::string& address, int port);
+    static Socket Connect(const std::string& host, int port);
+
+    Socket accept();
+    int port() const;
+    Handle handle() const { return m_handle; }
+    bool valid() const { return m_handle != Invalid; }
+    void close();
+    void setNonBlocking(bool enable);
+
+    // Sends everything, waiting for the socket to drain if it is non-blocking
+    void sendAll(const void* data, size_t size);
+    // Returns false if the peer closed the connection before `size` bytes arrived
+    bool recvAll(void* data, size_t size);
+    // Returns the number of bytes read, 0 on EOF and -1 if a non-blocking socket has no data
+    long recvSome(void* data, size_t size);
+
+    // Waits until one of the sockets is readable; `readable` receives one flag per socket
+    static void Poll(Socket* const* sockets, size_t count, int timeoutMs, bool* readable);
+
+private:
+    explicit Socket(Handle handle) : m_handle(handle) {}
+
+#ifdef _WIN32
+    static const Handle Invalid = ~0ull;
+#else
+    static const Handle Invalid = -1;
+#endif
+    Handle m_handle = Invalid;
+};
+
+#endif //MANDELBROTSET_SOCKET_H
@@ -0,0 +1,42 @@
+#include "startuptimer.h"
+#include <cstdio>
+
+StartupTimer::StartupTimer()
+    : m_start(Clock::now()), m_last(m_start)
+{
+}
+
+void StartupTimer::phase(const std::string& name)
+{
+    Clock::time_point now = Clock::now();
+    Phase p = { name, std::chrono::duration<double, std::milli>(now - m_last).count(), false };
+    m_phases.push_back(p);
+    m_last = now;
+}
+
+void StartupTimer::background(const std::string& name, double ms)
+{
+    Phase p = { name, ms, true };
+    m_phases.push_back(p);
+}
+
+double StartupTimer::elapsedMs() const
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - m_start).count();
+}
+
+void StartupTimer::report(std::ostream& out) const
+{
+    char line[128];
+    double total = 0;
+    for(const Phase& p : m_phases)
+    {
+        if(!p.background)
+            total += p.ms;
+        std::snprintf(line, sizeof(line), "[Startup]: %-24s %8.2f ms%s\n", p.name.c_str(), p.ms,
+                      p.background ? "  (background)" : "");
+        out << line;
+    }
+    std::snprintf(line, sizeof(line), "[Startup]: %-24s %8.2f ms\n", "time to first frame", total);
+    out << line;
+}
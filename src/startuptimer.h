@@ -0,0 +1,36 @@
+#ifndef MANDELBROTSET_STARTUPTIMER_H
+#define MANDELBROTSET_STARTUPTIMER_H
+
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Durations of the consecutive phases of the window startup, up to the first frame
+class StartupTimer
+{
+public:
+    StartupTimer();
+
+    // Ends the current phase, which started at the previous call (or at construction)
+    void phase(const std::string& name);
+    // Work measured elsewhere, e.g. on another thread while the phases went on
+    void background(const std::string& name, double ms);
+
+    double elapsedMs() const;
+    void report(std::ostream& out) const;
+
+private:
+    struct Phase
+    {
+        std::string name;
+        double ms;
+        bool background;
+    };
+
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point m_start, m_last;
+    std::vector<Phase> m_phases;
+};
+
+#endif //MANDELBROTSET_STARTUPTIMER_H
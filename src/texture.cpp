@@ -1,16 +1,40 @@
 #include "texture.h"
+#include "assets.h"
 #include <GL/glew.h>
 #include <cstdarg>
+#include <iostream>
 #include <stb_image.h>
 
-uint32_t LoadPNG_1D(const char* path)
+PaletteImage DecodePNG_1D(const char* path)
 {
-    int m_width, m_height, m_bpp;
-    unsigned char* data;
-    uint32_t texture;
+    PaletteImage image;
+    image.path = path;
+    if(const EmbeddedPalette* embedded = Assets::FindPalette(path))
+    {
+        image.width = embedded->width;
+        image.height = 1;
+        image.rgba.assign(embedded->rgba, embedded->rgba + (size_t)embedded->width * 4);
+        return image;
+    }
+
+    int bpp;
+    const std::string diskPath = Assets::DiskPath(path);
+    stbi_set_flip_vertically_on_load_thread(true);
+    unsigned char* data = stbi_load(diskPath.c_str(), &image.width, &image.height, &bpp, 4);
+    if(!data)
+    {
+        std::cerr << "Warning: File " << diskPath << " could not be opened!\n";
+        image.width = image.height = 0;
+        return image;
+    }
+    image.rgba.assign(data, data + (size_t)image.width * image.height * 4);
+    stbi_image_free(data);
+    return image;
+}
 
-    stbi_set_flip_vertically_on_load(true);
-    data = stbi_load(path, &m_width, &m_height, &m_bpp, 4);
+uint32_t UploadTexture_1D(const PaletteImage& image)
+{
+    uint32_t texture;
 
     glEnable(GL_TEXTURE_1D);
     glGenTextures(1, &texture);
@@ -18,13 +42,17 @@ uint32_t LoadPNG_1D(const char* path)
     glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexImage1D(GL_TEXTURE_1D, 0, GL_RGBA8, m_width, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-
-    stbi_image_free(data);
+    glTexImage1D(GL_TEXTURE_1D, 0, GL_RGBA8, image.width, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                 image.rgba.empty() ? nullptr : image.rgba.data());
 
     return texture;
 }
 
+uint32_t LoadPNG_1D(const char* path)
+{
+    return UploadTexture_1D(DecodePNG_1D(path));
+}
+
 void LoadTexVectorVar(std::vector<uint32_t>& v, int n, ...)
 {
     v.clear();
@@ -36,4 +64,4 @@ void LoadTexVectorVar(std::vector<uint32_t>& v, int n, ...)
         v.push_back(LoadPNG_1D(path));
     }
     va_end(args);
-}
\ No newline at end of file
+}
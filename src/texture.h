@@ -1,6 +1,20 @@
 #pragma once
 #include <vector>
 #include <cstdint>
+#include <string>
+
+// RGBA8 pixels of a palette image, decoded but not yet on the GPU
+struct PaletteImage
+{
+    std::string path;
+    int width = 0, height = 0;
+    std::vector<uint8_t> rgba;
+};
+
+// Decoding does not touch OpenGL, so it can run on any thread
+PaletteImage DecodePNG_1D(const char* path);
+// Creates a 1D texture from the first row; needs the GL context
+uint32_t UploadTexture_1D(const PaletteImage& image);
 
 uint32_t LoadPNG_1D(const char* path);
 
@@ -0,0 +1,124 @@
+#include "threadpool.h"
+#include "profiler.h"
+#include <atomic>
+
+ThreadPool::ThreadPool(unsigned threads)
+{
+    if(threads == 0)
+        threads = std::thread::hardware_concurrency();
+    if(threads == 0)
+        threads = 1;
+    for(unsigned i = 0; i < threads; i++)
+        m_workers.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_jobAvailable.notify_all();
+    for(auto& t : m_workers)
+        t.join();
+}
+
+void ThreadPool::submit(Job job)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.push_back(std::move(job));
+        m_pending++;
+    }
+    m_jobAvailable.notify_one();
+}
+
+void ThreadPool::wait()
+{
+    PROFILE_SCOPE("wait");
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_allDone.wait(lock, [this]{ return m_pending == 0; });
+    if(m_error)
+    {
+        std::exception_ptr error = m_error;
+        m_error = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+void ThreadPool::parallelFor(int count, const std::function<void(int, unsigned)>& fn)
+{
+    // One job per worker pulling indices keeps the queue short for large counts
+    std::atomic<int> next(0);
+    std::mutex doneMutex;
+    std::condition_variable doneCv;
+    unsigned running = 0;
+    std::exception_ptr error;
+
+    unsigned jobs = size() < (unsigned)count ? size() : (unsigned)count;
+    for(unsigned j = 0; j < jobs; j++)
+    {
+        {
+            std::lock_guard<std::mutex> lock(doneMutex);
+            running++;
+        }
+        submit([&](unsigned worker)
+        {
+            try
+            {
+                for(int i = next++; i < count; i = next++)
+                    fn(i, worker);
+            }
+            catch(...)
+            {
+                std::lock_guard<std::mutex> lock(doneMutex);
+                if(!error)
+                    error = std::current_exception();
+                next = count;
+            }
+            std::lock_guard<std::mutex> lock(doneMutex);
+            if(--running == 0)
+                doneCv.notify_all();
+        });
+    }
+
+    std::unique_lock<std::mutex> lock(doneMutex);
+    doneCv.wait(lock, [&]{ return running == 0; });
+    if(error)
+        std::rethrow_exception(error);
+}
+
+void ThreadPool::workerLoop(unsigned index)
+{
+    PROFILE_THREAD_NAME("worker " + std::to_string(index));
+    while(true)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_jobAvailable.wait(lock, [this]{ return m_stop || !m_jobs.empty(); });
+            if(m_jobs.empty())
+                return;
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+
+        {
+            PROFILE_SCOPE("job");
+            try
+            {
+                job(index);
+            }
+            catch(...)
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if(!m_error)
+                    m_error = std::current_exception();
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if(--m_pending == 0)
+            m_allDone.notify_all();
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef MANDELBROTSET_THREADPOOL_H
+#define MANDELBROTSET_THREADPOOL_H
+
+#include <functional>
+#include <vector>
+#include <deque>
+#include <exception>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Fixed-size pool of worker threads. Jobs receive the index of the worker
+// running them so callers can keep per-thread state without locking. An exception
+// thrown by a job is rethrown on the thread that waits for it.
+class ThreadPool
+{
+public:
+    typedef std::function<void(unsigned)> Job;
+
+    // 0 threads means one per hardware thread
+    explicit ThreadPool(unsigned threads = 0);
+    ~ThreadPool();
+
+    unsigned size() const { return (unsigned)m_workers.size(); }
+
+    void submit(Job job);
+    // Blocks until every submitted job has finished, then rethrows the first
+    // exception thrown by one of them since the last wait()
+    void wait();
+    // Runs fn(index, worker) for index in [0, count) and waits for completion.
+    // After an exception the remaining indices are skipped and the first one is
+    // rethrown here. Must not be called from inside a job.
+    void parallelFor(int count, const std::function<void(int, unsigned)>& fn);
+
+private:
+    void workerLoop(unsigned index);
+
+    std::vector<std::thread> m_workers;
+    std::deque<Job> m_jobs;
+    std::mutex m_mutex;
+    std::condition_variable m_jobAvailable;
+    std::condition_variable m_allDone;
+    int m_pending = 0;
+    std::exception_ptr m_error;
+    bool m_stop = false;
+};
+
+#endif //MANDELBROTSET_THREADPOOL_H
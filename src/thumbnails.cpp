@@ -0,0 +1,116 @@
+#include "thumbnails.h"
+#include "fractal.h"
+#include "settings.h"
+#include "palette.h"
+#include "threadpool.h"
+#include "imagewriter.h"
+#include "fileutil.h"
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <cstdio>
+
+namespace
+{
+    struct Thumbnail
+    {
+        std::string location;
+        std::string output;
+        FractalParams params;
+    };
+
+    // "dir/seahorse.txt" -> "seahorse"
+    std::string BaseName(const std::string& path)
+    {
+        size_t slash = path.find_last_of("/\\");
+        std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+        size_t dot = name.rfind('.');
+        return dot == std::string::npos || dot == 0 ? name : name.substr(0, dot);
+    }
+}
+
+int RenderThumbnails(const ThumbnailJob& job)
+{
+    if(job.width <= 0 || job.height <= 0)
+        throw std::runtime_error("[Thumbnails]: Invalid thumbnail size");
+    if(job.locations.empty())
+        throw std::runtime_error("[Thumbnails]: No location files given");
+
+    typedef std::chrono::steady_clock Clock;
+
+    std::vector<Thumbnail> thumbs;
+    std::vector<std::string> errors;
+    std::set<std::string> names;
+    for(const std::string& location : job.locations)
+    {
+        Thumbnail t;
+        t.location = location;
+        t.output = job.output + "/" + BaseName(location) + "." + job.format;
+        if(!names.insert(t.output).second)
+            throw std::runtime_error("[Thumbnails]: Two locations would both be written to " + t.output);
+        if(!LoadCustomSettings(location.c_str(), t.params))
+        {
+            errors.push_back(location + ": could not read settings");
+            continue;
+        }
+        t.params.zoom *= (double)job.width / job.viewWidth;
+        thumbs.push_back(t);
+    }
+
+    // Longest jobs first, so that the last thumbnails left running are cheap ones.
+    // The iteration limit is the only cost estimate available without rendering.
+    std::stable_sort(thumbs.begin(), thumbs.end(), [](const Thumbnail& a, const Thumbnail& b)
+    {
+        return a.params.iter > b.params.iter;
+    });
+
+    MakeDirectories(job.output);
+    Palette palette(job.palette.c_str());
+    ThreadPool pool(job.threads);
+
+    const size_t pixels = (size_t)job.width * job.height;
+    std::vector<std::vector<uint32_t>> iters(pool.size(), std::vector<uint32_t>(pixels));
+    std::vector<std::vector<uint8_t>> rgb(pool.size(), std::vector<uint8_t>(pixels * 3));
+    std::vector<uint64_t> iterations(pool.size(), 0);
+    std::mutex errorMutex;
+
+    std::cout << "[Thumbnails]: " << thumbs.size() << " thumbnails of " << job.width << "x" << job.height
+              << " on " << pool.size() << " threads -> " << job.output << std::endl;
+
+    Clock::time_point start = Clock::now();
+    for(const Thumbnail& t : thumbs)
+    {
+        pool.submit([&](unsigned worker)
+        {
+            try
+            {
+                iterations[worker] += Fractal::RenderIterations(t.params, job.width, job.height, 0, 0, job.width,
+                                                                job.height, iters[worker].data(), job.width);
+                palette.colorize(iters[worker].data(), pixels, t.params.iter, t.params.freq, t.params.UVoffset,
+                                 rgb[worker].data());
+                WriteImage(t.output, job.width, job.height, rgb[worker].data(), 1);
+            }
+            catch(const std::exception& e)
+            {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                errors.push_back(t.location + ": " + e.what());
+            }
+        });
+    }
+    pool.wait();
+
+    for(const std::string& error : errors)
+        std::cerr << "[Thumbnails]: " << error << std::endl;
+
+    uint64_t total = 0;
+    for(uint64_t n : iterations)
+        total += n;
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    size_t done = job.locations.size() - errors.size();
+    std::printf("[Thumbnails]: %zu done, %zu failed in %.2fs  %.1f thumbnails/s  %.2f Mpix/s  %.3f Giter/s\n",
+                done, errors.size(), elapsed, done / elapsed, done * pixels / elapsed * 1e-6, total / elapsed * 1e-9);
+    return (int)errors.size();
+}
@@ -0,0 +1,23 @@
+#ifndef MANDELBROTSET_THUMBNAILS_H
+#define MANDELBROTSET_THUMBNAILS_H
+
+#include <string>
+#include <vector>
+
+// Previews of many saved locations (settings.txt format), one small image each
+struct ThumbnailJob
+{
+    std::vector<std::string> locations;
+    int width = 256, height = 256;
+    int viewWidth = 800;
+    unsigned threads = 0;
+    std::string palette = "img/pal.png";
+    std::string output = "thumbs";  // directory, images are named after the location files
+    std::string format = "png";
+};
+
+// Each thumbnail is rendered and encoded by a single worker, so the pool runs
+// as many thumbnails at once as it has threads. Returns the number of failures.
+int RenderThumbnails(const ThumbnailJob& job);
+
+#endif //MANDELBROTSET_THUMBNAILS_H
@@ -0,0 +1,184 @@
+#include "tune.h"
+#include "fractal.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    const char* TuningMagic = "MandelbrotSet tuning 1";
+    // Wider than the widest tile shape, so every candidate is timed at its real width
+    const int Width = 2048, Height = 128, Repeat = 3;
+
+    // Seahorse valley edge: a third of the pixels reach the limit, the rest escape
+    // after anything from a few to hundreds of iterations
+    FractalParams TuningView()
+    {
+        FractalParams params;
+        params.iter = 500;
+        params.zoom = 20000.0 * Width / 800;
+        params.OffX = 0.745;
+        params.OffY = -0.11;
+        return params;
+    }
+
+    // Best of Repeat renders of the tuning view, in Mpixel/s
+    double Measure(const Fractal::KernelInfo& kernel, int tileWidth, int tileHeight, ThreadPool& pool,
+                   std::vector<std::vector<uint32_t>>& scratch)
+    {
+        const FractalParams params = TuningView();
+        const int tilesX = (Width + tileWidth - 1) / tileWidth, tilesY = (Height + tileHeight - 1) / tileHeight;
+        for(std::vector<uint32_t>& s : scratch)
+            s.resize((size_t)tileWidth * tileHeight);
+
+        double best = 0;
+        for(int r = 0; r < Repeat; r++)
+        {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            pool.parallelFor(tilesX * tilesY, [&](int t, unsigned worker)
+            {
+                const int x0 = (t % tilesX) * tileWidth, y0 = (t / tilesX) * tileHeight;
+                const int w = std::min(tileWidth, Width - x0), h = std::min(tileHeight, Height - y0);
+                kernel.render(params, Width, Height, x0, y0, w, h, scratch[worker].data(), w);
+            });
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            best = std::max(best, (double)Width * Height / seconds * 1e-6);
+        }
+        return best;
+    }
+
+    // Differences within timing noise keep the earlier, more conventional choice
+    bool Faster(double mpix, double best)
+    {
+        return mpix > best * 1.03;
+    }
+}
+
+TuneResult AutoTune()
+{
+    const unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+    TuneResult best;
+    best.threads = hardware;
+
+    std::vector<std::vector<uint32_t>> scratch(hardware);
+    {
+        ThreadPool pool(hardware);
+        for(int k = 0; k < Fractal::KernelCount; k++)
+        {
+            double mpix = Measure(Fractal::Kernels[k], best.tileWidth, best.tileHeight, pool, scratch);
+            std::printf("[Tune]: kernel %-8s %8.2f Mpix/s\n", Fractal::Kernels[k].name, mpix);
+            if(Faster(mpix, best.mpixPerSecond))
+            {
+                best.mpixPerSecond = mpix;
+                best.kernel = Fractal::Kernels[k].name;
+            }
+        }
+
+        // Tall tiles keep the cost per tile even, wide ones keep rows contiguous
+        const int shapes[][2] = { { 32, 32 }, { 64, 16 }, { 128, 32 }, { 256, 64 }, { 512, 16 }, { 1024, 8 } };
+        const Fractal::KernelInfo& kernel = *Fractal::FindKernel(best.kernel);
+        for(const int* shape : shapes)
+        {
+            double mpix = Measure(kernel, shape[0], shape[1], pool, scratch);
+            std::printf("[Tune]: tile %4dx%-4d %8.2f Mpix/s\n", shape[0], shape[1], mpix);
+            if(Faster(mpix, best.mpixPerSecond))
+            {
+                best.mpixPerSecond = mpix;
+                best.tileWidth = shape[0];
+                best.tileHeight = shape[1];
+            }
+        }
+    }
+
+    // More threads than cores only helps when the pool is kept busy, so try fewer too
+    for(unsigned threads = hardware / 2; threads >= 1; threads /= 2)
+    {
+        ThreadPool pool(threads);
+        double mpix = Measure(*Fractal::FindKernel(best.kernel), best.tileWidth, best.tileHeight, pool, scratch);
+        std::printf("[Tune]: threads %-4u %8.2f Mpix/s\n", threads, mpix);
+        if(Faster(mpix, best.mpixPerSecond))
+        {
+            best.mpixPerSecond = mpix;
+            best.threads = threads;
+        }
+    }
+
+    std::printf("[Tune]: kernel %s, tiles %dx%d, %u threads (%.2f Mpix/s)\n", best.kernel.c_str(),
+                best.tileWidth, best.tileHeight, best.threads, best.mpixPerSecond);
+    return best;
+}
+
+bool LoadTuning(const std::string& path, TuneResult& result)
+{
+    std::ifstream in(path);
+    std::string magic;
+    if(!std::getline(in, magic) || magic != TuningMagic)
+        return false;
+
+    TuneResult r;
+    unsigned hardware = 0;
+    int kernels = 0;
+    std::string line;
+    while(std::getline(in, line))
+    {
+        std::istringstream ss(line);
+        std::string key;
+        ss >> key;
+        if(key == "hardware_threads")
+            ss >> hardware;
+        else if(key == "kernels")
+            ss >> kernels;
+        else if(key == "kernel")
+            ss >> r.kernel;
+        else if(key == "tile")
+            ss >> r.tileWidth >> r.tileHeight;
+        else if(key == "threads")
+            ss >> r.threads;
+        else if(key == "mpix_per_s")
+            ss >> r.mpixPerSecond;
+    }
+
+    // Stale when the machine or the kernels changed, or the kernel no longer exists
+    if(hardware != std::thread::hardware_concurrency() || kernels != Fractal::KernelTableVersion
+       || !Fractal::FindKernel(r.kernel) || r.tileWidth <= 0 || r.tileHeight <= 0)
+        return false;
+    result = r;
+    return true;
+}
+
+void SaveTuning(const std::string& path, const TuneResult& result)
+{
+    std::ofstream out(path, std::ios::trunc);
+    out << TuningMagic << "\n"
+        << "hardware_threads " << std::thread::hardware_concurrency() << "\n"
+        << "kernels " << Fractal::KernelTableVersion << "\n"
+        << "kernel " << result.kernel << "\n"
+        << "tile " << result.tileWidth << " " << result.tileHeight << "\n"
+        << "threads " << result.threads << "\n"
+        << "mpix_per_s " << result.mpixPerSecond << "\n";
+    if(!out)
+        throw std::runtime_error("[Tune]: Could not write " + path);
+}
+
+TuneResult LoadOrTune(const std::string& path)
+{
+    TuneResult result;
+    if(LoadTuning(path, result))
+    {
+        std::cout << "[Tune]: using " << path << ": kernel " << result.kernel << ", tiles " << result.tileWidth
+                  << "x" << result.tileHeight << ", " << result.threads << " threads" << std::endl;
+        return result;
+    }
+    std::cout << "[Tune]: no tuning for this machine in " << path << ", measuring" << std::endl;
+    result = AutoTune();
+    SaveTuning(path, result);
+    std::cout << "[Tune]: saved to " << path << std::endl;
+    return result;
+}
@@ -0,0 +1,29 @@
+#ifndef MANDELBROTSET_TUNE_H
+#define MANDELBROTSET_TUNE_H
+
+#include <string>
+
+// Fastest strip rendering configuration found for this machine and set of kernels
+struct TuneResult
+{
+    std::string kernel = "scalar";
+    int tileWidth = 256, tileHeight = 64;
+    unsigned threads = 0;       // 0 = all hardware threads
+    double mpixPerSecond = 0;   // of the winning configuration on the tuning view
+};
+
+// Times short renders of a view mixing cheap and expensive pixels: first every kernel,
+// then tile shapes with the fastest kernel, then thread counts with the fastest tile.
+// Takes a few seconds on a single core and less on more.
+TuneResult AutoTune();
+
+// The tuning file holds "key value" lines. It is only valid for the machine (hardware
+// thread count) and kernels (Fractal::KernelTableVersion) it was written for;
+// LoadTuning returns false otherwise.
+bool LoadTuning(const std::string& path, TuneResult& result);
+void SaveTuning(const std::string& path, const TuneResult& result);
+
+// Loads the tuning file, or tunes and writes it when it is missing or stale
+TuneResult LoadOrTune(const std::string& path);
+
+#endif //MANDELBROTSET_TUNE_H
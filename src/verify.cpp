@@ -0,0 +1,164 @@
+#include "verify.h"
+#include "bench.h"
+#include "fractal.h"
+#include "threadpool.h"
+#include "random.h"
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+
+namespace
+{
+#if defined(__SIZEOF_FLOAT128__)
+    typedef __float128 Extended;
+#else
+    typedef long double Extended;
+#endif
+
+    // IterationsNumber() and PixelToComplex() carried out in the extended type
+    int ReferenceIterations(const FractalParams& params, int width, int height, int px, int py)
+    {
+        const Extended fx = (Extended)px + 0.5, fy = (Extended)(height - py) - 0.5;
+        const Extended cx = (fx - (Extended)width / 2) / (Extended)params.zoom - (Extended)params.OffX;
+        const Extended cy = (fy - (Extended)height / 2) / (Extended)params.zoom - (Extended)params.OffY;
+
+        int n = 0;
+        Extended x = 0, y = 0;
+        for(int i = 1; i <= params.iter; i++)
+        {
+            Extended zx = x*x - y*y + cx;
+            Extended zy = 2 * x * y + cy;
+            if(zx*zx + zy*zy > 4)
+                break;
+            x = zx;
+            y = zy;
+            n++;
+        }
+        return n;
+    }
+
+    void Render(const Fractal::KernelInfo& kernel, const FractalParams& params, int width, int height,
+                ThreadPool& pool, std::vector<uint32_t>& iters)
+    {
+        const int StripRows = 8;
+        iters.assign((size_t)width * height, 0);
+        pool.parallelFor((height + StripRows - 1) / StripRows, [&](int s, unsigned)
+        {
+            const int y0 = s * StripRows;
+            kernel.render(params, width, height, 0, y0, width, std::min(StripRows, height - y0),
+                          iters.data() + (size_t)y0 * width, width);
+        });
+    }
+
+    uint32_t Difference(uint32_t a, uint32_t b)
+    {
+        return a > b ? a - b : b - a;
+    }
+
+    template<typename T>
+    bool Selected(const std::vector<std::string>& names, const T& item)
+    {
+        return names.empty() || std::find(names.begin(), names.end(), item.name) != names.end();
+    }
+}
+
+const char* ReferencePrecision()
+{
+#if defined(__SIZEOF_FLOAT128__)
+    return "__float128";
+#else
+    return "long double";
+#endif
+}
+
+int RunVerify(const VerifyJob& job)
+{
+    if(job.width <= 0 || job.height <= 0 || job.samples < 0)
+        throw std::runtime_error("[Verify]: Invalid job");
+
+    std::vector<const Fractal::KernelInfo*> kernels;
+    for(int k = 0; k < Fractal::KernelCount; k++)
+        if(Selected(job.kernels, Fractal::Kernels[k]))
+            kernels.push_back(&Fractal::Kernels[k]);
+    if(kernels.empty())
+        throw std::runtime_error("[Verify]: No kernel matches the selection");
+
+    ThreadPool pool(job.threads);
+    int failures = 0, checks = 0;
+    std::printf("[Verify]: %dx%d, %d samples against %s, reference kernel %s\n", job.width, job.height,
+                job.samples, ReferencePrecision(), kernels[0]->name);
+
+    for(const CanonicalView& view : CanonicalViews())
+    {
+        if(!Selected(job.views, view))
+            continue;
+        FractalParams params = view.params;
+        params.zoom *= job.width / 800.0;
+
+        std::vector<std::vector<uint32_t>> images(kernels.size());
+        for(size_t k = 0; k < kernels.size(); k++)
+            Render(*kernels[k], params, job.width, job.height, pool, images[k]);
+
+        // Every kernel against the reference kernel, all pixels
+        for(size_t k = 1; k < kernels.size(); k++)
+        {
+            checks++;
+            size_t mismatched = 0, worst = 0;
+            uint32_t maxDiff = 0;
+            for(size_t i = 0; i < images[k].size(); i++)
+            {
+                uint32_t diff = Difference(images[k][i], images[0][i]);
+                if(!diff)
+                    continue;
+                if(diff > maxDiff)
+                {
+                    maxDiff = diff;
+                    worst = i;
+                }
+                mismatched++;
+            }
+            std::printf("[Verify]: %-10s %-8s vs %-8s %s  %zu pixels differ", view.name, kernels[k]->name,
+                        kernels[0]->name, mismatched ? "FAIL" : "ok  ", mismatched);
+            if(mismatched)
+                std::printf(", max %u at (%zu, %zu)", maxDiff, worst % job.width, worst / job.width);
+            std::printf("\n");
+            if(mismatched)
+                failures++;
+        }
+
+        // Random pixels against the extended precision reference, shared by all kernels
+        Random random(job.seed);
+        std::vector<int> samplePixels(job.samples), reference(job.samples);
+        for(int s = 0; s < job.samples; s++)
+            samplePixels[s] = (int)(random.next() % ((uint64_t)job.width * job.height));
+        pool.parallelFor(job.samples, [&](int s, unsigned)
+        {
+            reference[s] = ReferenceIterations(params, job.width, job.height, samplePixels[s] % job.width,
+                                               samplePixels[s] / job.width);
+        });
+        for(size_t k = 0; k < kernels.size(); k++)
+        {
+            checks++;
+            int mismatched = 0;
+            uint32_t maxDiff = 0;
+            double sumDiff = 0;
+            for(int s = 0; s < job.samples; s++)
+            {
+                uint32_t diff = Difference(images[k][samplePixels[s]], (uint32_t)reference[s]);
+                mismatched += diff != 0;
+                maxDiff = std::max(maxDiff, diff);
+                sumDiff += diff;
+            }
+            const double fraction = job.samples ? (double)mismatched / job.samples : 0.0;
+            const bool ok = fraction <= job.tolerance;
+            std::printf("[Verify]: %-10s %-8s vs %-11s %s  %.2f%% of samples differ, max %u, mean %.2f iterations\n",
+                        view.name, kernels[k]->name, ReferencePrecision(), ok ? "ok  " : "FAIL", fraction * 100,
+                        maxDiff, job.samples ? sumDiff / job.samples : 0.0);
+            if(!ok)
+                failures++;
+        }
+    }
+
+    std::printf("[Verify]: %d of %d checks failed\n", failures, checks);
+    return failures;
+}
@@ -0,0 +1,31 @@
+#ifndef MANDELBROTSET_VERIFY_H
+#define MANDELBROTSET_VERIFY_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Differential check of the CPU kernels on the canonical views. Every kernel renders
+// the whole view and is compared pixel by pixel with the first (reference) kernel,
+// and random pixels are recomputed in extended precision (__float128 where the
+// compiler has it, long double otherwise) to show how far double precision drifts.
+struct VerifyJob
+{
+    int width = 320, height = 180;
+    unsigned threads = 0;               // 0 = all hardware threads
+    std::vector<std::string> views;     // empty = all
+    std::vector<std::string> kernels;   // empty = all
+    int samples = 2000;                 // pixels checked against the extended precision reference
+    uint64_t seed = 1;
+    // Fraction of samples allowed to differ from the extended precision reference;
+    // kernels must always agree with each other exactly
+    double tolerance = 1.0;
+};
+
+// Name of the extended precision type in use
+const char* ReferencePrecision();
+
+// Returns the number of failed checks
+int RunVerify(const VerifyJob& job);
+
+#endif //MANDELBROTSET_VERIFY_H
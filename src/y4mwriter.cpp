@@ -0,0 +1,93 @@
+#include "y4mwriter.h"
+#include <algorithm>
+#include <stdexcept>
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+static uint8_t Clamp8(float v)
+{
+    return v < 0 ? 0 : v > 255 ? 255 : (uint8_t)(v + 0.5f);
+}
+
+void RGBToYUV420(const uint8_t* rgb, int width, int height, std::vector<uint8_t>& yuv)
+{
+    const int cw = (width + 1) / 2, ch = (height + 1) / 2;
+    yuv.resize((size_t)width * height + 2 * (size_t)cw * ch);
+    uint8_t* Y = yuv.data();
+    uint8_t* U = Y + (size_t)width * height;
+    uint8_t* V = U + (size_t)cw * ch;
+
+    for(size_t i = 0; i < (size_t)width * height; i++)
+    {
+        const uint8_t* p = rgb + i * 3;
+        Y[i] = Clamp8(0.299f * p[0] + 0.587f * p[1] + 0.114f * p[2]);
+    }
+
+    for(int cy = 0; cy < ch; cy++)
+        for(int cx = 0; cx < cw; cx++)
+        {
+            float r = 0, g = 0, b = 0;
+            int n = 0;
+            for(int y = 2 * cy; y < std::min(2 * cy + 2, height); y++)
+                for(int x = 2 * cx; x < std::min(2 * cx + 2, width); x++)
+                {
+                    const uint8_t* p = rgb + ((size_t)y * width + x) * 3;
+                    r += p[0]; g += p[1]; b += p[2];
+                    n++;
+                }
+            r /= n; g /= n; b /= n;
+            U[(size_t)cy * cw + cx] = Clamp8(-0.168736f * r - 0.331264f * g + 0.5f * b + 128);
+            V[(size_t)cy * cw + cx] = Clamp8(0.5f * r - 0.418688f * g - 0.081312f * b + 128);
+        }
+}
+
+Y4MWriter::Y4MWriter(const std::string& path, int width, int height, int fps)
+    :m_stdout(path == "-"), m_width(width), m_height(height)
+{
+    if(m_stdout)
+    {
+        m_file = stdout;
+#ifdef _WIN32
+        _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    }
+    else
+        m_file = std::fopen(path.c_str(), "wb");
+    if(!m_file)
+        throw std::runtime_error("[Y4M]: Could not open " + path + " for writing");
+    std::fprintf(m_file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", width, height, fps);
+}
+
+Y4MWriter::~Y4MWriter()
+{
+    if(m_file && !m_stdout)
+        std::fclose(m_file);
+}
+
+size_t Y4MWriter::frameBytes() const
+{
+    return (size_t)m_width * m_height + 2 * (size_t)((m_width + 1) / 2) * ((m_height + 1) / 2);
+}
+
+void Y4MWriter::writeFrame(const uint8_t* rgb)
+{
+    RGBToYUV420(rgb, m_width, m_height, m_yuv);
+    writeFrameYUV(m_yuv.data());
+}
+
+void Y4MWriter::writeFrameYUV(const uint8_t* yuv)
+{
+    std::fputs("FRAME\n", m_file);
+    if(std::fwrite(yuv, 1, frameBytes(), m_file) != frameBytes())
+        throw std::runtime_error("[Y4M]: Write failed");
+}
+
+void Y4MWriter::finish()
+{
+    int err = m_stdout ? std::fflush(m_file) : std::fclose(m_file);
+    m_file = nullptr;
+    if(err != 0)
+        throw std::runtime_error("[Y4M]: Write failed");
+}
@@ -0,0 +1,37 @@
+#ifndef MANDELBROTSET_Y4MWRITER_H
+#define MANDELBROTSET_Y4MWRITER_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Converts packed RGB to planar full-range BT.601 YUV 4:2:0 (chroma averaged over 2x2 pixels).
+// `yuv` receives the Y plane followed by the U and V planes.
+void RGBToYUV420(const uint8_t* rgb, int width, int height, std::vector<uint8_t>& yuv);
+
+// Uncompressed YUV4MPEG2 stream (C420jpeg), readable by ffmpeg and most encoders.
+// The path "-" writes to stdout.
+class Y4MWriter
+{
+public:
+    Y4MWriter(const std::string& path, int width, int height, int fps);
+    ~Y4MWriter();
+
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+    // Size of one planar frame in bytes
+    size_t frameBytes() const;
+
+    void writeFrame(const uint8_t* rgb);
+    void writeFrameYUV(const uint8_t* yuv);
+    void finish();
+
+private:
+    FILE* m_file;
+    bool m_stdout;
+    int m_width, m_height;
+    std::vector<uint8_t> m_yuv;
+};
+
+#endif //MANDELBROTSET_Y4MWRITER_H
@@ -0,0 +1,402 @@
+#include "zoomvideo.h"
+#include "palette.h"
+#include "threadpool.h"
+#include "boundedqueue.h"
+#include "y4mwriter.h"
+#include "profiler.h"
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <cstdio>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    const int BandRows = 16;
+    const double Pi = 3.14159265358979323846;
+
+    struct Frame
+    {
+        int index;
+        float freq, UVoffset;
+        int iter;
+        std::vector<uint32_t> iters;   // empty when the producer already made the colors
+        std::vector<uint8_t> rgb;
+        std::vector<uint8_t> yuv;
+    };
+
+    // Runs a pipeline stage on its own thread; after a failure the stage keeps
+    // draining its input so upstream stages never block
+    class Stage
+    {
+    public:
+        // `name` labels the thread and its per-frame zones in profiles
+        template<typename Fn>
+        Stage(const char* name, BoundedQueue<Frame>& in, Fn fn)
+            :m_thread([this, name, &in, fn]() mutable
+            {
+                PROFILE_THREAD_NAME(name);
+                Frame frame;
+                while(in.pop(frame))
+                {
+                    if(m_error)
+                        continue;
+                    PROFILE_SCOPE(name);
+                    try { fn(frame); }
+                    catch(...) { m_error = std::current_exception(); }
+                }
+            })
+        {}
+
+        void join(BoundedQueue<Frame>* out)
+        {
+            m_thread.join();
+            if(out)
+                out->close();
+        }
+
+        void rethrow() const
+        {
+            if(m_error)
+                std::rethrow_exception(m_error);
+        }
+
+    private:
+        std::exception_ptr m_error;
+        std::thread m_thread;
+    };
+
+    // Exponential map of the zoom target: row k samples the circle of radius
+    // rMax * exp(-k * step) around the center, column a the angle 2*pi*a/columns - pi.
+    // With step = 2*pi/columns the samples are square in log-polar space, so one
+    // strip holds every frame of the zoom at (at least) the resolution of its corners.
+    class LogPolarStrip
+    {
+    public:
+        LogPolarStrip(const ZoomVideoJob& job, double firstZoom, double lastZoom)
+        {
+            const double halfDiagonal = 0.5 * std::sqrt((double)job.width * job.width + (double)job.height * job.height);
+            m_columns = std::max(8, (int)std::ceil(2 * Pi * halfDiagonal));
+            m_step = 2 * Pi / m_columns;
+            m_rMax = halfDiagonal / firstZoom;
+            const double rMin = 0.5 / lastZoom;
+            m_rows = (int)std::ceil(std::log(m_rMax / rMin) / m_step) + 2;
+            m_centerX = -job.params.OffX;
+            m_centerY = -job.params.OffY;
+        }
+
+        int rows() const { return m_rows; }
+        int columns() const { return m_columns; }
+
+        void render(const FractalParams& params, const Palette& palette, ThreadPool& pool)
+        {
+            m_rgb.resize((size_t)m_rows * m_columns * 3);
+            std::vector<std::vector<uint32_t>> scratch(pool.size(), std::vector<uint32_t>(m_columns));
+            pool.parallelFor(m_rows, [&](int k, unsigned worker)
+            {
+                const double r = m_rMax * std::exp(-k * m_step);
+                uint32_t* iters = scratch[worker].data();
+                for(int a = 0; a < m_columns; a++)
+                {
+                    const double theta = a * m_step - Pi;
+                    iters[a] = Fractal::IterationsNumber(m_centerX + r * std::cos(theta), m_centerY + r * std::sin(theta),
+                                                         params.iter);
+                }
+                palette.colorize(iters, m_columns, params.iter, params.freq, params.UVoffset,
+                                 &m_rgb[(size_t)k * m_columns * 3]);
+            });
+        }
+
+        // Bilinear resampling of the frame with the given (output scaled) zoom
+        void resample(int width, int height, double zoom, int y0, int rows, uint8_t* rgb) const
+        {
+            for(int y = y0; y < y0 + rows; y++)
+                for(int x = 0; x < width; x++)
+                {
+                    const double dx = (x + 0.5 - width / 2.0) / zoom;
+                    const double dy = (height / 2.0 - (y + 0.5)) / zoom;
+                    const double r = std::sqrt(dx * dx + dy * dy);
+                    double v = r > 0 ? std::log(m_rMax / r) / m_step : m_rows - 1;
+                    v = std::min(std::max(v, 0.0), (double)m_rows - 1);
+                    const double u = (std::atan2(dy, dx) + Pi) / m_step;
+
+                    const int v0 = std::min((int)v, m_rows - 2);
+                    const int u0 = (int)std::floor(u);
+                    const float fv = float(v - v0), fu = float(u - u0);
+                    const int a0 = ((u0 % m_columns) + m_columns) % m_columns, a1 = (a0 + 1) % m_columns;
+                    const uint8_t* p00 = &m_rgb[((size_t)v0 * m_columns + a0) * 3];
+                    const uint8_t* p01 = &m_rgb[((size_t)v0 * m_columns + a1) * 3];
+                    const uint8_t* p10 = &m_rgb[((size_t)(v0 + 1) * m_columns + a0) * 3];
+                    const uint8_t* p11 = &m_rgb[((size_t)(v0 + 1) * m_columns + a1) * 3];
+                    uint8_t* out = rgb + ((size_t)y * width + x) * 3;
+                    for(int c = 0; c < 3; c++)
+                    {
+                        float top = p00[c] + (p01[c] - p00[c]) * fu;
+                        float bottom = p10[c] + (p11[c] - p10[c]) * fu;
+                        out[c] = (uint8_t)(top + (bottom - top) * fv + 0.5f);
+                    }
+                }
+        }
+
+    private:
+        int m_rows, m_columns;
+        double m_step, m_rMax;
+        double m_centerX, m_centerY;
+        std::vector<uint8_t> m_rgb;
+    };
+
+    // A frame rendered at twice the output resolution, so that every frame up to
+    // twice its zoom can be cropped from it without upscaling
+    class Keyframe
+    {
+    public:
+        Keyframe(const ZoomVideoJob& job, double zoom) : m_zoom(zoom), m_width(2 * job.width), m_height(2 * job.height) {}
+
+        double zoom() const { return m_zoom; }
+
+        void render(const FractalParams& view, const Palette& palette, ThreadPool& pool)
+        {
+            FractalParams params = view;
+            params.zoom = 2 * m_zoom;
+            m_rgb.resize((size_t)m_width * m_height * 3);
+            std::vector<std::vector<uint32_t>> scratch(pool.size(), std::vector<uint32_t>((size_t)m_width * BandRows));
+            const int bands = (m_height + BandRows - 1) / BandRows;
+            pool.parallelFor(bands, [&](int band, unsigned worker)
+            {
+                const int y0 = band * BandRows;
+                const int rows = std::min(BandRows, m_height - y0);
+                uint32_t* iters = scratch[worker].data();
+                Fractal::RenderIterations(params, m_width, m_height, 0, y0, m_width, rows, iters, m_width);
+                palette.colorize(iters, (size_t)m_width * rows, params.iter, params.freq, params.UVoffset,
+                                 &m_rgb[(size_t)y0 * m_width * 3]);
+            });
+        }
+
+        // Fraction of the keyframe's half extent covered by an offset (dx, dy) from the center;
+        // values above 1 lie outside
+        double extent(double dx, double dy) const
+        {
+            return std::max(std::fabs(dx) * 4 * m_zoom / m_width, std::fabs(dy) * 4 * m_zoom / m_height);
+        }
+
+        // Bilinear sample at an offset from the center in the complex plane
+        void sample(double dx, double dy, float* out) const
+        {
+            const double x = std::min(std::max(m_width / 2.0 + dx * 2 * m_zoom - 0.5, 0.0), m_width - 1.0);
+            const double y = std::min(std::max(m_height / 2.0 - dy * 2 * m_zoom - 0.5, 0.0), m_height - 1.0);
+            const int x0 = std::min((int)x, m_width - 2), y0 = std::min((int)y, m_height - 2);
+            const float fx = float(x - x0), fy = float(y - y0);
+            const uint8_t* p = &m_rgb[((size_t)y0 * m_width + x0) * 3];
+            const size_t stride = (size_t)m_width * 3;
+            for(int c = 0; c < 3; c++)
+            {
+                float top = p[c] + (p[c + 3] - p[c]) * fx;
+                float bottom = p[stride + c] + (p[stride + c + 3] - p[stride + c]) * fx;
+                out[c] = top + (bottom - top) * fy;
+            }
+        }
+
+    private:
+        double m_zoom;
+        int m_width, m_height;
+        std::vector<uint8_t> m_rgb;
+    };
+
+    // Width of the band along the inner keyframe's edge over which it fades in
+    const double KeyframeBlendMargin = 0.15;
+
+    double SmoothStep(double t)
+    {
+        t = std::min(std::max(t, 0.0), 1.0);
+        return t * t * (3 - 2 * t);
+    }
+
+    // Synthesizes a frame between two keyframes. The inner keyframe (twice the zoom)
+    // carries the detail near the center; it fades in both towards its edge and over
+    // the time between the keyframes so consecutive segments join without a jump.
+    void SynthesizeFrame(const Keyframe& outer, const Keyframe& inner, int width, int height, double zoom,
+                         int y0, int rows, uint8_t* rgb)
+    {
+        const double t = SmoothStep(std::log(zoom / outer.zoom()) / std::log(2.0));
+        for(int y = y0; y < y0 + rows; y++)
+            for(int x = 0; x < width; x++)
+            {
+                const double dx = (x + 0.5 - width / 2.0) / zoom;
+                const double dy = (height / 2.0 - (y + 0.5)) / zoom;
+                float a[3], b[3];
+                outer.sample(dx, dy, a);
+                const double w = t * SmoothStep((1 - inner.extent(dx, dy)) / KeyframeBlendMargin);
+                if(w > 0)
+                {
+                    inner.sample(dx, dy, b);
+                    for(int c = 0; c < 3; c++)
+                        a[c] += (b[c] - a[c]) * (float)w;
+                }
+                uint8_t* out = rgb + ((size_t)y * width + x) * 3;
+                for(int c = 0; c < 3; c++)
+                    out[c] = (uint8_t)(a[c] + 0.5f);
+            }
+    }
+}
+
+int ZoomVideoFrameCount(const ZoomVideoJob& job)
+{
+    if(job.frames > 0)
+        return job.frames;
+    if(job.zoomRate <= 1.0 || job.targetZoom <= job.params.zoom)
+        throw std::runtime_error("[Video]: The target zoom must be reached by zooming in");
+    return (int)std::ceil(std::log(job.targetZoom / job.params.zoom) / std::log(job.zoomRate)) + 1;
+}
+
+void RenderZoomVideo(const ZoomVideoJob& job)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    // Both resampling methods build on the views of larger zooms: the strip runs inward
+    // from the first frame and every keyframe is bracketed by the next doubling
+    if(job.method != ZoomVideoJob::Direct && job.zoomRate <= 1.0)
+        throw std::runtime_error("[Video]: The logpolar and keyframe methods only zoom in, --rate must be above 1");
+    if(job.zoomRate <= 0)
+        throw std::runtime_error("[Video]: --rate must be positive");
+    const int frames = ZoomVideoFrameCount(job);
+    Palette palette(job.palette.c_str());
+    ThreadPool pool(job.threads);
+    Y4MWriter writer(job.output, job.width, job.height, job.fps);
+
+    const size_t pixels = (size_t)job.width * job.height;
+    const int bands = (job.height + BandRows - 1) / BandRows;
+    std::fprintf(stderr, "[Video]: %d frames of %dx%d on %u threads -> %s\n", frames, job.width, job.height,
+                 pool.size(), job.output.c_str());
+
+    // render (pool) -> color + convert -> write
+    BoundedQueue<Frame> toColor(2), toWrite(2);
+    Stage color("color", toColor, [&](Frame& frame)
+    {
+        if(!frame.iters.empty())
+        {
+            frame.rgb.resize(pixels * 3);
+            palette.colorize(frame.iters.data(), pixels, frame.iter, frame.freq, frame.UVoffset, frame.rgb.data());
+            frame.iters = std::vector<uint32_t>();
+        }
+        RGBToYUV420(frame.rgb.data(), job.width, job.height, frame.yuv);
+        frame.rgb = std::vector<uint8_t>();
+        toWrite.push(std::move(frame));
+    });
+    Stage write("write", toWrite, [&](Frame& frame)
+    {
+        writer.writeFrameYUV(frame.yuv.data());
+    });
+
+    const double scale = (double)job.width / job.viewWidth;
+    Clock::time_point start = Clock::now(), lastReport = start;
+
+    // Ends the pipeline after the last frame, or when producing one failed: the stages
+    // drain what is queued so their threads can be joined before unwinding
+    auto finishStages = [&]()
+    {
+        toColor.close();
+        color.join(&toWrite);
+        write.join(nullptr);
+    };
+    int keyframesRendered = 0;
+    try
+    {
+        std::unique_ptr<LogPolarStrip> strip;
+        if(job.method == ZoomVideoJob::LogPolar)
+        {
+            strip.reset(new LogPolarStrip(job, job.params.zoom * scale,
+                                          job.params.zoom * std::pow(job.zoomRate, frames - 1) * scale));
+            std::fprintf(stderr, "[Video]: rendering %dx%d log-polar strip\n", strip->columns(), strip->rows());
+            strip->render(job.params, palette, pool);
+            std::fprintf(stderr, "[Video]: strip done in %.2fs\n",
+                         std::chrono::duration<double>(Clock::now() - start).count());
+        }
+
+        // keyframes[0] and keyframes[1] bracket the current frame
+        std::unique_ptr<Keyframe> keyframes[2];
+
+        for(int n = 0; n < frames; n++)
+        {
+            const double zoom = job.params.zoom * std::pow(job.zoomRate, n);
+            FractalParams params = job.params;
+            params.zoom = zoom * scale;
+
+            if(job.method == ZoomVideoJob::Keyframe)
+            {
+                while(!keyframes[1] || params.zoom >= keyframes[1]->zoom())
+                {
+                    const double keyZoom = job.params.zoom * scale * std::pow(2.0, keyframesRendered);
+                    keyframes[0] = std::move(keyframes[1]);
+                    keyframes[1].reset(new Keyframe(job, keyZoom));
+                    keyframes[1]->render(job.params, palette, pool);
+                    keyframesRendered++;
+                }
+            }
+
+            PROFILE_SCOPE("render frame");
+            Frame frame;
+            frame.index = n;
+            frame.iter = params.iter;
+            frame.freq = params.freq;
+            frame.UVoffset = params.UVoffset;
+            if(job.method == ZoomVideoJob::Keyframe)
+            {
+                frame.rgb.resize(pixels * 3);
+                pool.parallelFor(bands, [&](int band, unsigned)
+                {
+                    int y0 = band * BandRows;
+                    SynthesizeFrame(*keyframes[0], *keyframes[1], job.width, job.height, params.zoom, y0,
+                                    std::min(BandRows, job.height - y0), frame.rgb.data());
+                });
+            }
+            else if(strip)
+            {
+                frame.rgb.resize(pixels * 3);
+                pool.parallelFor(bands, [&](int band, unsigned)
+                {
+                    int y0 = band * BandRows;
+                    strip->resample(job.width, job.height, params.zoom, y0, std::min(BandRows, job.height - y0),
+                                    frame.rgb.data());
+                });
+            }
+            else
+            {
+                frame.iters.resize(pixels);
+                pool.parallelFor(bands, [&](int band, unsigned)
+                {
+                    int y0 = band * BandRows;
+                    int rows = std::min(BandRows, job.height - y0);
+                    Fractal::RenderIterations(params, job.width, job.height, 0, y0, job.width, rows,
+                                              frame.iters.data() + (size_t)y0 * job.width, job.width);
+                });
+            }
+            toColor.push(std::move(frame));
+
+            Clock::time_point now = Clock::now();
+            if(now - lastReport > std::chrono::seconds(1))
+            {
+                double elapsed = std::chrono::duration<double>(now - start).count();
+                std::fprintf(stderr, "\r[Video]: frame %d/%d  %.2f fps  zoom %.4g   ", n + 1, frames,
+                             (n + 1) / elapsed, zoom);
+                lastReport = now;
+            }
+        }
+    }
+    catch(...)
+    {
+        finishStages();
+        throw;
+    }
+    finishStages();
+    color.rethrow();
+    write.rethrow();
+    writer.finish();
+
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    std::fprintf(stderr, "\r[Video]: %d frames in %.2fs (%.2f fps)\n", frames, elapsed, frames / elapsed);
+    if(keyframesRendered)
+        std::fprintf(stderr, "[Video]: %d keyframes rendered\n", keyframesRendered);
+}
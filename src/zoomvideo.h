@@ -0,0 +1,37 @@
+#ifndef MANDELBROTSET_ZOOMVIDEO_H
+#define MANDELBROTSET_ZOOMVIDEO_H
+
+#include <string>
+#include "fractal.h"
+
+// Headless version of the "Auto Zoom" animation: the zoom is multiplied by
+// `zoomRate` every frame, from params.zoom until `targetZoom` is reached.
+struct ZoomVideoJob
+{
+    enum Method
+    {
+        Direct = 0,     // every frame rendered independently
+        LogPolar = 1,   // frames resampled from one exponential-map strip around the center
+        Keyframe = 2    // frames cropped from keyframes rendered at every doubling of the zoom
+    };
+
+    FractalParams params;
+    Method method = Direct;
+    int width = 1280, height = 720;
+    int viewWidth = 800;
+    double targetZoom = 1e6;
+    double zoomRate = 1.01;
+    int frames = 0;         // 0 = derived from targetZoom and zoomRate
+    int fps = 30;
+    unsigned threads = 0;
+    std::string palette = "img/pal.png";
+    std::string output = "zoom.y4m";  // "-" for stdout
+};
+
+int ZoomVideoFrameCount(const ZoomVideoJob& job);
+
+// Renders the frames to a Y4M stream. Rendering frame N+1 overlaps coloring
+// and writing of frame N.
+void RenderZoomVideo(const ZoomVideoJob& job);
+
+#endif //MANDELBROTSET_ZOOMVIDEO_H
@@ -0,0 +1,43 @@
+#!/bin/sh
+# Kills a poster render with SIGKILL after its first checkpoint, reruns it and checks that the
+# resumed file is byte-identical to an uninterrupted render. Run from the source tree:
+#   tools/checkpoint_test.sh path/to/MandelbrotSet [work directory]
+set -e
+
+BIN=$1
+DIR=${2:-checkpoint_test}
+if [ -z "$BIN" ]; then
+    echo "usage: $0 MandelbrotSet [work directory]" >&2
+    exit 2
+fi
+
+# One thread and fixed strips keep the render slow enough to be interrupted and independent of tuning
+POSTER="poster --no-tune --threads 1 --strip 16 --size 4000x2250 --iter 2000 --checkpoint-interval 1"
+
+mkdir -p "$DIR"
+rm -f "$DIR"/reference.png "$DIR"/resumed.png "$DIR"/resumed.png.ckpt
+
+echo "[Checkpoint test]: uninterrupted render"
+"$BIN" $POSTER --out "$DIR"/reference.png > /dev/null
+
+echo "[Checkpoint test]: render killed after the first checkpoint"
+"$BIN" $POSTER --out "$DIR"/resumed.png > /dev/null &
+PID=$!
+while [ ! -f "$DIR"/resumed.png.ckpt ]; do
+    if ! kill -0 $PID 2> /dev/null; then
+        echo "[Checkpoint test]: render finished before writing a checkpoint, increase --size" >&2
+        exit 1
+    fi
+    sleep 0.1
+done
+kill -9 $PID
+wait $PID 2> /dev/null || true
+
+echo "[Checkpoint test]: resumed render"
+"$BIN" $POSTER --out "$DIR"/resumed.png | grep "resuming" || { echo "[Checkpoint test]: render did not resume" >&2; exit 1; }
+
+if cmp "$DIR"/reference.png "$DIR"/resumed.png; then
+    echo "[Checkpoint test]: resumed render is identical"
+else
+    exit 1
+fi
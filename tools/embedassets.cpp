@@ -0,0 +1,121 @@
+// Build step that turns the shaders and palettes of the source tree into a C++ file
+// defining the tables of src/assets.h. Run from the source tree:
+//   embedassets OUTPUT.cpp shaders/fragment.glsl img/pal.png ...
+// .glsl files are embedded as text, images as the RGBA row used by the 1D textures.
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static bool EndsWith(const std::string& s, const std::string& suffix)
+{
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// One string literal per line, so the output stays readable and within compiler limits
+static void WriteStringLiteral(std::ostream& out, const std::string& text)
+{
+    out << "        \"";
+    for(size_t i = 0; i < text.size(); i++)
+    {
+        char c = text[i];
+        if(c == '\\' || c == '"')
+            out << '\\' << c;
+        else if(c == '\n')
+        {
+            out << "\\n\"";
+            if(i + 1 < text.size())
+                out << "\n        \"";
+            else
+                return;
+        }
+        else if(c == '\r')
+            continue;
+        else if(c == '\t')
+            out << "\\t";
+        else
+            out << c;
+    }
+    out << "\"";
+}
+
+int main(int argc, char** argv)
+{
+    if(argc < 2)
+    {
+        std::cerr << "Usage: embedassets OUTPUT.cpp [FILE.glsl | FILE.png]...\n";
+        return 1;
+    }
+
+    std::ostringstream out;
+    std::vector<std::string> shaders, palettes;
+    std::vector<int> widths;
+    out << "// Generated by tools/embedassets.cpp, do not edit\n"
+        << "#include \"assets.h\"\n\n"
+        << "namespace\n{\n";
+
+    for(int a = 2; a < argc; a++)
+    {
+        const std::string path = argv[a];
+        if(EndsWith(path, ".glsl"))
+        {
+            std::ifstream in(path, std::ios::binary);
+            if(!in.is_open())
+            {
+                std::cerr << "[Embed]: Could not open " << path << "\n";
+                return 1;
+            }
+            std::stringstream ss;
+            ss << in.rdbuf();
+            out << "    const char Shader" << shaders.size() << "[] =\n";
+            WriteStringLiteral(out, ss.str());
+            out << ";\n\n";
+            shaders.push_back(path);
+        }
+        else
+        {
+            int width, height, bpp;
+            unsigned char* data = stbi_load(path.c_str(), &width, &height, &bpp, 4);
+            if(!data)
+            {
+                std::cerr << "[Embed]: Could not decode " << path << "\n";
+                return 1;
+            }
+            // The window flips images on load and uploads the first row, i.e. the bottom one
+            const unsigned char* row = data + (size_t)(height - 1) * width * 4;
+            out << "    const uint8_t Palette" << palettes.size() << "[] =\n    {";
+            for(int i = 0; i < width * 4; i++)
+                out << (i % 16 ? " " : "\n        ") << (int)row[i] << ",";
+            out << "\n    };\n\n";
+            stbi_image_free(data);
+            palettes.push_back(path);
+            widths.push_back(width);
+        }
+    }
+    out << "}\n\n";
+
+    // A trailing empty entry keeps the arrays non-empty
+    out << "const EmbeddedShader EmbeddedShaders[] =\n{\n";
+    for(size_t i = 0; i < shaders.size(); i++)
+        out << "    { \"" << shaders[i] << "\", Shader" << i << " },\n";
+    out << "    { nullptr, nullptr }\n};\n"
+        << "const int EmbeddedShaderCount = " << shaders.size() << ";\n\n";
+    out << "const EmbeddedPalette EmbeddedPalettes[] =\n{\n";
+    for(size_t i = 0; i < palettes.size(); i++)
+        out << "    { \"" << palettes[i] << "\", " << widths[i] << ", Palette" << i << " },\n";
+    out << "    { nullptr, 0, nullptr }\n};\n"
+        << "const int EmbeddedPaletteCount = " << palettes.size() << ";\n";
+
+    std::ofstream file(argv[1], std::ios::binary | std::ios::trunc);
+    file << out.str();
+    if(!file)
+    {
+        std::cerr << "[Embed]: Could not write " << argv[1] << "\n";
+        return 1;
+    }
+    return 0;
+}